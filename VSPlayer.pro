@@ -28,6 +28,18 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11
 
+# Counts the heap allocations of every analysis stage by wrapping malloc() of glibc, e.g. qmake CONFIG+=count_allocations.
+# Off by default, since it replaces the allocator of the whole process and does not work with sanitizers
+count_allocations: DEFINES += VSPLAYER_COUNT_ALLOCATIONS
+
+# Media files are decoded in-process when the FFmpeg libraries are found,
+# otherwise the ffmpeg executable is started for every file
+packagesExist(libavformat libavcodec libavutil libswresample) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libavformat libavcodec libavutil libswresample
+    DEFINES += VSPLAYER_WITH_LIBAV
+}
+
 SOURCES += \
     src/main.cpp \
     src/videowidget.cpp \
@@ -40,7 +52,25 @@ SOURCES += \
     src/audiodecoder.cpp \
     src/wavfilereader.cpp \
     src/wavfile.cpp \
-    src/audiodecoderexception.cpp
+    src/audiodecoderexception.cpp \
+    src/fftengine.cpp \
+    src/realfftengine.cpp \
+    src/fftplan.cpp \
+    src/simdkernels.cpp \
+    src/stftframer.cpp \
+    src/streamingspectrumanalyzer.cpp \
+    src/spectrogram.cpp \
+    src/libavaudiodecoder.cpp \
+    src/wavstreamreader.cpp \
+    src/analysiscache.cpp \
+    src/spectrogramfile.cpp \
+    src/fingerprintextractor.cpp \
+    src/fingerprintindex.cpp \
+    src/clipsearch.cpp \
+    src/headlessmode.cpp \
+    src/shardedfingerprintindex.cpp \
+    src/pipelinestats.cpp \
+    src/scratcharena.cpp
 
 HEADERS += \
     src/videowidget.h \
@@ -53,7 +83,27 @@ HEADERS += \
     src/audiodecoder.h \
     src/wavfilereader.h \
     src/wavfile.h \
-    src/audiodecoderexception.h
+    src/audiodecoderexception.h \
+    src/fftengine.h \
+    src/spectrumanalyzerexception.h \
+    src/realfftengine.h \
+    src/fftplan.h \
+    src/simdkernels.h \
+    src/stftframer.h \
+    src/streamingspectrumanalyzer.h \
+    src/spectrogram.h \
+    src/libavaudiodecoder.h \
+    src/wavstreamreader.h \
+    src/analysiscache.h \
+    src/spectrogramfile.h \
+    src/fingerprint.h \
+    src/fingerprintextractor.h \
+    src/fingerprintindex.h \
+    src/clipsearch.h \
+    src/headlessmode.h \
+    src/shardedfingerprintindex.h \
+    src/pipelinestats.h \
+    src/scratcharena.h
 
 FORMS += \
     src/mainwindow.ui
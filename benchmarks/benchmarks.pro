@@ -0,0 +1,52 @@
+#-------------------------------------------------
+#
+# Benchmarks of the analysis pipeline, built on Google Benchmark.
+# Results are written as JSON to stdout, or to a file with --benchmark_out=<file>
+#
+#-------------------------------------------------
+
+QT       += core \
+            multimedia \
+            concurrent
+
+QT       -= gui
+
+TARGET = VSPlayerBenchmarks
+TEMPLATE = app
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# Timings of a debug build say nothing about the released player
+CONFIG(debug, debug|release): warning("Benchmarks are meaningful in release builds only")
+
+INCLUDEPATH += ../src
+
+LIBS += -lbenchmark
+unix: LIBS += -lpthread
+win32: LIBS += -lshlwapi
+
+SOURCES += \
+    pipelinebenchmarks.cpp \
+    ../src/baseexception.cpp \
+    ../src/filereaderexception.cpp \
+    ../src/pipelinestats.cpp \
+    ../src/fftengine.cpp \
+    ../src/realfftengine.cpp \
+    ../src/fftplan.cpp \
+    ../src/simdkernels.cpp \
+    ../src/stftframer.cpp \
+    ../src/spectrogram.cpp \
+    ../src/spectrogramfile.cpp \
+    ../src/spectrumanalyzer.cpp \
+    ../src/wavdata.cpp \
+    ../src/wavfilereader.cpp \
+    ../src/wavstreamreader.cpp
+
+HEADERS += \
+    ../src/spectrumanalyzer.h \
+    ../src/wavdata.h \
+    ../src/wavfilereader.h \
+    ../src/wavstreamreader.h
@@ -0,0 +1,324 @@
+#include <benchmark/benchmark.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <qmath.h>
+#include <qendian.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "fftengine.h"
+#include "realfftengine.h"
+#include "simdkernels.h"
+#include "spectrumanalyzer.h"
+#include "spectrogramfile.h"
+#include "wavdata.h"
+#include "wavfilereader.h"
+
+// Benchmarks of the stages a file goes through before it is searchable:
+// reading the decoded WAV, splitting the channels, the FFT, the spectrogram and the CSV export.
+// Every input is generated from a fixed seed, so the results of different runs and machines are comparable.
+
+// The rate AudioDecoder resamples every file to
+static const quint32 SAMPLE_RATE_HZ = 25600;
+static const quint32 RANDOM_SEED = 20190325;
+static const int SIGNAL_DURATION_S = 30;
+
+// A chord of three tones over low noise, which gives the spectrogram peaks to find
+static QVector<qint16> syntheticSamples(const qint64 samplesCount, const int channelsCount = 1)
+{
+    static const double FREQUENCIES_HZ[] = { 440.0, 554.37, 659.25 };
+
+    std::mt19937 random(RANDOM_SEED);
+    std::uniform_int_distribution<int> noise(-512, 512);
+
+    QVector<qint16> samples(static_cast<int>(samplesCount * channelsCount));
+    for (qint64 i = 0; i < samplesCount; i++)
+    {
+        double value = 0.0;
+        for (const auto frequencyHz : FREQUENCIES_HZ)
+        {
+            value += 8000.0 * qSin(2.0 * M_PI * frequencyHz * i / SAMPLE_RATE_HZ);
+        }
+
+        for (auto channel = 0; channel < channelsCount; channel++)
+        {
+            samples[static_cast<int>(i * channelsCount + channel)] = static_cast<qint16>(value + noise(random));
+        }
+    }
+
+    return samples;
+}
+
+template<typename T>
+static QVector<std::complex<T>> syntheticComplexValues(const int count)
+{
+    std::mt19937 random(RANDOM_SEED);
+    std::uniform_real_distribution<T> values(-1, 1);
+
+    QVector<std::complex<T>> complexValues(count);
+    for (auto &complexValue : complexValues)
+    {
+        complexValue = std::complex<T>(values(random), values(random));
+    }
+
+    return complexValues;
+}
+
+// Canonical 44-byte header followed by the interleaved samples
+static bool writeWavFile(const QString &filePath, const QVector<qint16> &samples, const quint16 channelsCount)
+{
+    const quint32 dataSize = static_cast<quint32>(samples.count() * sizeof(qint16));
+    const quint16 blockAlign = channelsCount * sizeof(qint16);
+
+    QByteArray header;
+    const auto appendLittleEndian32 = [&header](const quint32 value) {
+        char bytes[4];
+        qToLittleEndian(value, reinterpret_cast<uchar *>(bytes));
+        header.append(bytes, 4);
+    };
+    const auto appendLittleEndian16 = [&header](const quint16 value) {
+        char bytes[2];
+        qToLittleEndian(value, reinterpret_cast<uchar *>(bytes));
+        header.append(bytes, 2);
+    };
+
+    header.append("RIFF");
+    appendLittleEndian32(36 + dataSize);
+    header.append("WAVEfmt ");
+    appendLittleEndian32(16);
+    appendLittleEndian16(1);
+    appendLittleEndian16(channelsCount);
+    appendLittleEndian32(SAMPLE_RATE_HZ);
+    appendLittleEndian32(SAMPLE_RATE_HZ * blockAlign);
+    appendLittleEndian16(blockAlign);
+    appendLittleEndian16(16);
+    header.append("data");
+    appendLittleEndian32(dataSize);
+
+    QFile file(filePath);
+    return file.open(QIODevice::WriteOnly)
+        && file.write(header) == header.size()
+        && file.write(reinterpret_cast<const char *>(samples.constData()), dataSize) == dataSize;
+}
+
+template<typename T>
+static void BM_FftEngine(benchmark::State &state)
+{
+    const auto size = static_cast<int>(state.range(0));
+    const FftEngine<T> fftEngine(size);
+    const auto input = syntheticComplexValues<T>(size);
+    auto data = input;
+
+    for (auto _ : state)
+    {
+        // Transforming the output again would grow it without bound, so every iteration starts
+        // from the same values. The copy is linear and small next to the transform
+        std::copy(input.constBegin(), input.constEnd(), data.begin());
+        fftEngine.transform(data.data());
+        benchmark::DoNotOptimize(data.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK_TEMPLATE(BM_FftEngine, float)->RangeMultiplier(4)->Range(256, 16384);
+BENCHMARK_TEMPLATE(BM_FftEngine, double)->RangeMultiplier(4)->Range(256, 16384);
+
+template<typename T>
+static void BM_RealFftEngine(benchmark::State &state)
+{
+    const auto size = static_cast<int>(state.range(0));
+    const RealFftEngine<T> fftEngine(size);
+    const auto input = syntheticComplexValues<T>(fftEngine.spectrumSize());
+    auto data = input;
+
+    for (auto _ : state)
+    {
+        std::copy(input.constBegin(), input.constEnd(), data.begin());
+        fftEngine.transform(data.data());
+        benchmark::DoNotOptimize(data.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK_TEMPLATE(BM_RealFftEngine, float)->RangeMultiplier(4)->Range(256, 16384);
+BENCHMARK_TEMPLATE(BM_RealFftEngine, double)->RangeMultiplier(4)->Range(256, 16384);
+
+// Arguments: FFT mode, precision, samples per fragment and hop size
+static void BM_GetFrequencySpectrogram(benchmark::State &state)
+{
+    const auto samples = syntheticSamples(static_cast<qint64>(SAMPLE_RATE_HZ) * SIGNAL_DURATION_S);
+    const auto samplesPerFragment = static_cast<int>(state.range(2));
+    const auto hopSize = static_cast<int>(state.range(3));
+    const auto window = samplesPerFragment == hopSize ? StftFramer::RectangularWindow : StftFramer::HannWindow;
+
+    SpectrumAnalyzer spectrumAnalyzer(nullptr);
+    spectrumAnalyzer.setFftMode(static_cast<SpectrumAnalyzer::FftMode>(state.range(0)));
+    spectrumAnalyzer.setPrecision(static_cast<SpectrumAnalyzer::Precision>(state.range(1)));
+
+    for (auto _ : state)
+    {
+        const auto spectrogram = spectrumAnalyzer.getFrequencySpectrogram(&samples, SAMPLE_RATE_HZ, samplesPerFragment, hopSize, window);
+        benchmark::DoNotOptimize(spectrogram.constData());
+    }
+
+    state.SetBytesProcessed(state.iterations() * samples.count() * static_cast<qint64>(sizeof(qint16)));
+}
+BENCHMARK(BM_GetFrequencySpectrogram)
+    ->ArgNames({ "fftMode", "precision", "fragment", "hop" })
+    ->Args({ SpectrumAnalyzer::ComplexFft, SpectrumAnalyzer::DoublePrecision, 512, 512 })
+    ->Args({ SpectrumAnalyzer::RealFft, SpectrumAnalyzer::DoublePrecision, 512, 512 })
+    ->Args({ SpectrumAnalyzer::RealFft, SpectrumAnalyzer::SinglePrecision, 512, 512 })
+    ->Args({ SpectrumAnalyzer::RealFft, SpectrumAnalyzer::SinglePrecision, 2048, 512 })
+    ->Unit(benchmark::kMillisecond);
+
+// Splitting decoded stereo frames into the channel buffers, by the instruction set of the kernels
+static void BM_DeinterleaveStereo(benchmark::State &state)
+{
+    const auto instructionSet = static_cast<SimdKernels::InstructionSet>(state.range(0));
+    const auto kernels = SimdKernels::forInstructionSet(instructionSet);
+    if (kernels == nullptr)
+    {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+
+    const auto framesCount = static_cast<int>(SAMPLE_RATE_HZ * SIGNAL_DURATION_S);
+    const auto frames = syntheticSamples(framesCount, 2);
+    QVector<qint16> left(framesCount);
+    QVector<qint16> right(framesCount);
+
+    state.SetLabel(SimdKernels::instructionSetName(instructionSet));
+
+    for (auto _ : state)
+    {
+        kernels->deinterleaveStereo(frames.constData(), left.data(), right.data(), framesCount);
+        benchmark::DoNotOptimize(left.data());
+        benchmark::DoNotOptimize(right.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * frames.count() * static_cast<qint64>(sizeof(qint16)));
+}
+BENCHMARK(BM_DeinterleaveStereo)->DenseRange(SimdKernels::Scalar, SimdKernels::Avx2);
+
+static void BM_DownmixStereo(benchmark::State &state)
+{
+    const auto instructionSet = static_cast<SimdKernels::InstructionSet>(state.range(0));
+    const auto kernels = SimdKernels::forInstructionSet(instructionSet);
+    if (kernels == nullptr)
+    {
+        state.SkipWithError("Instruction set not supported");
+        return;
+    }
+
+    const auto framesCount = static_cast<int>(SAMPLE_RATE_HZ * SIGNAL_DURATION_S);
+    const auto frames = syntheticSamples(framesCount, 2);
+    QVector<qint16> mono(framesCount);
+
+    state.SetLabel(SimdKernels::instructionSetName(instructionSet));
+
+    for (auto _ : state)
+    {
+        kernels->downmixStereo(frames.constData(), mono.data(), framesCount);
+        benchmark::DoNotOptimize(mono.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * frames.count() * static_cast<qint64>(sizeof(qint16)));
+}
+BENCHMARK(BM_DownmixStereo)->DenseRange(SimdKernels::Scalar, SimdKernels::Avx2);
+
+// Reading the WAV file the decoder writes, by the read mode. The file stays in the page cache between iterations.
+// Mapping alone does not read anything, so every sample is summed for both modes to do comparable work
+static void BM_WavFileReader(benchmark::State &state)
+{
+    const QTemporaryDir directory;
+    const auto filePath = directory.filePath("benchmark.wav");
+    const auto samples = syntheticSamples(static_cast<qint64>(SAMPLE_RATE_HZ) * SIGNAL_DURATION_S, 2);
+    if (!directory.isValid() || !writeWavFile(filePath, samples, 2))
+    {
+        state.SkipWithError("Error writing the WAV file");
+        return;
+    }
+
+    WavFileReader wavFileReader(filePath);
+    wavFileReader.setReadMode(static_cast<WavFileReader::ReadMode>(state.range(0)));
+    state.SetLabel(state.range(0) == WavFileReader::MappedRead ? "mapped" : "buffered");
+
+    for (auto _ : state)
+    {
+        WavData wavData;
+        wavFileReader.readWavData(&wavData);
+
+        const auto audioBuffer = wavData.audioBuffer();
+        const auto audioSamples = reinterpret_cast<const qint16 *>(audioBuffer->constData());
+        const auto samplesCount = audioBuffer->size() / static_cast<int>(sizeof(qint16));
+
+        qint64 sum = 0;
+        for (auto i = 0; i < samplesCount; i++)
+        {
+            sum += audioSamples[i];
+        }
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * samples.count() * static_cast<qint64>(sizeof(qint16)));
+}
+BENCHMARK(BM_WavFileReader)->Arg(WavFileReader::BufferedRead)->Arg(WavFileReader::MappedRead);
+
+static void BM_ExportCsv(benchmark::State &state)
+{
+    const QTemporaryDir directory;
+    const auto filePath = directory.filePath("benchmark.csv");
+    const auto samples = syntheticSamples(static_cast<qint64>(SAMPLE_RATE_HZ) * SIGNAL_DURATION_S);
+
+    const SpectrumAnalyzer spectrumAnalyzer(nullptr);
+    const auto spectrogram = spectrumAnalyzer.getFrequencySpectrogram(&samples, SAMPLE_RATE_HZ, 512, 512, StftFramer::RectangularWindow);
+
+    for (auto _ : state)
+    {
+        if (!SpectrogramFile::exportCsv(filePath, spectrogram))
+        {
+            state.SkipWithError("Error writing the CSV file");
+            return;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * spectrogram.framesCount() * spectrogram.bandsCount());
+    state.SetBytesProcessed(state.iterations() * QFile(filePath).size());
+}
+BENCHMARK(BM_ExportCsv)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char *argv[])
+{
+    // Results are tracked over time by tools, so they are written as JSON unless another format is asked for
+    std::vector<char *> arguments(argv, argv + argc);
+    std::string jsonFormat("--benchmark_format=json");
+
+    auto formatGiven = false;
+    for (auto i = 1; i < argc; i++)
+    {
+        formatGiven = formatGiven || std::string(argv[i]).compare(0, 19, "--benchmark_format=") == 0;
+    }
+
+    if (!formatGiven)
+    {
+        arguments.push_back(&jsonFormat[0]);
+    }
+
+    auto argumentsCount = static_cast<int>(arguments.size());
+    benchmark::Initialize(&argumentsCount, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(argumentsCount, arguments.data()))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
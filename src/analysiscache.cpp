@@ -0,0 +1,112 @@
+#include "analysiscache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include "spectrogramfile.h"
+
+const qint64 AnalysisCache::DEFAULT_MAX_SIZE_BYTES = 256 * 1024 * 1024;
+const char AnalysisCache::ENTRY_SUFFIX[] = ".spectrogram";
+
+AnalysisCache::AnalysisCache(const QString &directoryPath, const qint64 maxSizeBytes, QObject *parent)
+    : QObject(parent),
+      _directory(directoryPath),
+      _maxSizeBytes(maxSizeBytes)
+{
+    _directory.mkpath(".");
+}
+
+AnalysisCache::~AnalysisCache()
+{
+}
+
+QString AnalysisCache::defaultDirectoryPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/spectrograms";
+}
+
+void AnalysisCache::setMaxSizeBytes(const qint64 maxSizeBytes)
+{
+    {
+        const QMutexLocker locker(&_mutex);
+        _maxSizeBytes = maxSizeBytes;
+    }
+
+    evictLeastRecentlyUsed();
+}
+
+bool AnalysisCache::load(const QString &mediaFilePath, const QByteArray &analysisParameters, Spectrogram *spectrogram) const
+{
+    const auto filePath = entryFilePath(mediaFilePath, analysisParameters);
+
+    SpectrogramFile entryFile(filePath);
+    if (!entryFile.open())
+    {
+        return false;
+    }
+
+    *spectrogram = entryFile.toSpectrogram();
+    entryFile.close();
+
+    // The modification time is the last use time of the entry for the eviction
+    QFile touchedFile(filePath);
+    if (touchedFile.open(QIODevice::ReadWrite))
+    {
+        touchedFile.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    }
+
+    return true;
+}
+
+void AnalysisCache::store(const QString &mediaFilePath, const QByteArray &analysisParameters, const Spectrogram &spectrogram)
+{
+    if (SpectrogramFile::write(entryFilePath(mediaFilePath, analysisParameters), spectrogram))
+    {
+        evictLeastRecentlyUsed();
+    }
+}
+
+void AnalysisCache::clear()
+{
+    const QMutexLocker locker(&_mutex);
+
+    for (const auto &entry : _directory.entryInfoList(QStringList() << QString("*") + ENTRY_SUFFIX, QDir::Files))
+    {
+        QFile::remove(entry.absoluteFilePath());
+    }
+}
+
+QString AnalysisCache::entryFilePath(const QString &mediaFilePath, const QByteArray &analysisParameters) const
+{
+    const QFileInfo mediaFile(mediaFilePath);
+
+    // Any change of the media file changes its size or modification time, which makes its old entries unreachable
+    QCryptographicHash key(QCryptographicHash::Sha1);
+    key.addData(mediaFile.absoluteFilePath().toUtf8());
+    key.addData(QByteArray::number(mediaFile.size()));
+    key.addData(QByteArray::number(mediaFile.lastModified().toMSecsSinceEpoch()));
+    key.addData(analysisParameters);
+
+    const QMutexLocker locker(&_mutex);
+    return _directory.filePath(QString::fromLatin1(key.result().toHex()) + ENTRY_SUFFIX);
+}
+
+void AnalysisCache::evictLeastRecentlyUsed() const
+{
+    const QMutexLocker locker(&_mutex);
+
+    // The most recently used entries come first
+    const auto entries = _directory.entryInfoList(QStringList() << QString("*") + ENTRY_SUFFIX, QDir::Files, QDir::Time);
+
+    qint64 totalSize = 0;
+    for (const auto &entry : entries)
+    {
+        totalSize += entry.size();
+
+        if (totalSize > _maxSizeBytes)
+        {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QObject>
+#include <QDir>
+#include <QMutex>
+#include "spectrogram.h"
+
+// On-disk cache of spectrograms, so media files that were analyzed before are not decoded again.
+// Entries are keyed by the file path, size and modification time together with the analysis parameters.
+// The cache is kept under its size limit by evicting the least recently used entries,
+// whose use is tracked through the modification times of the entry files.
+// The cache may be used from several analysis threads at once.
+class AnalysisCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const qint64 DEFAULT_MAX_SIZE_BYTES;
+
+    explicit AnalysisCache(const QString &directoryPath, qint64 maxSizeBytes = DEFAULT_MAX_SIZE_BYTES,
+                           QObject *parent = nullptr);
+    ~AnalysisCache();
+
+    // Cache directory of the application, used when no other one is given
+    static QString defaultDirectoryPath();
+
+    qint64 maxSizeBytes() const { return _maxSizeBytes; }
+    void setMaxSizeBytes(qint64 maxSizeBytes);
+
+    // Returns false if the file was not analyzed with the parameters or was changed since then
+    bool load(const QString &mediaFilePath, const QByteArray &analysisParameters, Spectrogram *spectrogram) const;
+    void store(const QString &mediaFilePath, const QByteArray &analysisParameters, const Spectrogram &spectrogram);
+
+    void clear();
+
+private:
+    static const char ENTRY_SUFFIX[];
+
+    QDir _directory;
+    qint64 _maxSizeBytes;
+    mutable QMutex _mutex;
+
+    QString entryFilePath(const QString &mediaFilePath, const QByteArray &analysisParameters) const;
+    void evictLeastRecentlyUsed() const;
+};
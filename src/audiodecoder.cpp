@@ -2,22 +2,30 @@
 #include "audiodecoderexception.h"
 #include "wavfilereader.h"
 #include "pcmaudiodata.h"
+#include "libavaudiodecoder.h"
+#include "streamingspectrumanalyzer.h"
+#include "simdkernels.h"
+#include "pipelinestats.h"
+#include "scratcharena.h"
 
 #include <QAudioDeviceInfo>
+#include <QProcess>
+#include <QThread>
 #include <QtConcurrent>
+#include <QScopedPointer>
 #include <qendian.h>
+#include <cstring>
 
-const QString AudioDecoder::TEMP_WAV_FILE = "soundfile.wav";
-const QString AudioDecoder::OUTPUT_LOG = "logs/ffmpeg/outputs.txt";
-const QString AudioDecoder::ERROR_LOG = "logs/ffmpeg/errors.txt";
+const QString AudioDecoder::TEMP_WAV_FILE = "soundfile-%1.wav";
+const QString AudioDecoder::OUTPUT_LOG = "logs/ffmpeg/outputs-%1.txt";
+const QString AudioDecoder::ERROR_LOG = "logs/ffmpeg/errors-%1.txt";
+const int AudioDecoder::PIPE_READ_BUFFER_SIZE = 256 * 1024;
 
 const int AudioDecoder::SAMPLE_RATE_HZ = 25600;
 const int AudioDecoder::SAMPLE_SIZE_BITS = 16;
 const int AudioDecoder::CHANNELS_COUNT = 2;
 const QString AudioDecoder::DEFAULT_CODEC = "pcm_s16le";
 
-const qint8 AudioDecoder::LEFT_CHANNEL = 0;
-const qint8 AudioDecoder::RIGHT_CHANNEL = 1;
 
 AudioDecoder::AudioDecoder(QObject* pobj) : QObject(pobj)
 {
@@ -29,16 +37,168 @@ AudioDecoder::~AudioDecoder()
 
 const PcmAudioData *AudioDecoder::decode(const QString &filePath) const
 {
+#ifdef VSPLAYER_WITH_LIBAV
+    QByteArray audioBuffer;
+    {
+        PipelineStats::StageTimer stageTimer(PipelineStats::MediaDecoding);
+
+        const LibavAudioDecoder libavAudioDecoder(SAMPLE_RATE_HZ, CHANNELS_COUNT);
+        audioBuffer = libavAudioDecoder.decode(filePath);
+
+        stageTimer.addBytes(audioBuffer.size());
+        stageTimer.addFrames(audioBuffer.size() / (CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8));
+    }
+
+    return rawAudioDataToPcmByChannels(&audioBuffer);
+#else
+    // Without the FFmpeg libraries the media file is converted by the ffmpeg executable
+    if (_ffmpegOutput == PipedOutput)
+    {
+        return pipedAudioToPcmByChannels(filePath);
+    }
+
     WavData wavData;
 
-    const auto audioFilePath = mediaToAudio(filePath);
+    const auto tempWavFile = perThreadFilePath(TEMP_WAV_FILE);
+    const auto audioFilePath = mediaToAudio(filePath, &tempWavFile);
     const auto rawAudioData = audioToRawAudioData(audioFilePath, &wavData);
-    const auto pcmAudioData = rawAudioDataToPcmByChannels(rawAudioData);
+    const auto pcmAudioData = rawAudioDataToPcmByChannels(rawAudioData->audioBuffer());
 
     return pcmAudioData;
+#endif
+}
+
+void AudioDecoder::decode(const QString &filePath, StreamingSpectrumAnalyzer *analyzer) const
+{
+    QVector<qint16> analyzedBlock;
+    QVector<qint16> rightChannelBlock;
+
+    const auto consumeBlock = [&](const qint16 *allChannelsData, const int framesCount) {
+        {
+            PipelineStats::StageTimer stageTimer(PipelineStats::ChannelSplit);
+            stageTimer.addBytes(framesCount * CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8);
+            stageTimer.addFrames(framesCount);
+
+            // Unlike clear(), resizing keeps the capacity, so the blocks are allocated once rather than for every read
+            analyzedBlock.resize(0);
+
+            if (_downmixToMono)
+            {
+                appendMonoData(allChannelsData, framesCount, &analyzedBlock);
+            }
+            else
+            {
+                rightChannelBlock.resize(0);
+                appendChannelsData(allChannelsData, framesCount, &analyzedBlock, &rightChannelBlock);
+            }
+        }
+
+        analyzer->process(analyzedBlock.constData(), analyzedBlock.count());
+    };
+
+#ifdef VSPLAYER_WITH_LIBAV
+    {
+        // Includes the time the analysis of the blocks takes, which is measured as stages of its own
+        PipelineStats::StageTimer stageTimer(PipelineStats::MediaDecoding);
+
+        const LibavAudioDecoder libavAudioDecoder(SAMPLE_RATE_HZ, CHANNELS_COUNT);
+        libavAudioDecoder.decode(filePath, [&](const qint16 *allChannelsData, const int framesCount) {
+            stageTimer.addBytes(framesCount * CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8);
+            stageTimer.addFrames(framesCount);
+
+            consumeBlock(allChannelsData, framesCount);
+        });
+    }
+#else
+    readPipedAudio(filePath, consumeBlock);
+#endif
+
+    analyzer->finish();
 }
 
-const QString *AudioDecoder::mediaToAudio(const QString &mediaFilePath) const
+template<typename BlockConsumer>
+void AudioDecoder::readPipedAudio(const QString &mediaFilePath, BlockConsumer consumeBlock) const
+{
+    const auto args = QStringList()
+        << "-nostdin"
+        << "-i"     << mediaFilePath    // input file
+        << "-vn"
+        << "-ar"    << QString::number(SAMPLE_RATE_HZ)
+        << "-ac"    << QString::number(CHANNELS_COUNT)
+        << "-c:a"   << DEFAULT_CODEC
+        << "-f"     << "s16le"          // raw samples without a header
+        << "pipe:1";                    // standard output
+
+    // Includes the time the consumer of the blocks takes, which is measured as stages of its own
+    PipelineStats::StageTimer stageTimer(PipelineStats::MediaDecoding);
+
+    QProcess process;
+    process.setStandardErrorFile(perThreadFilePath(ERROR_LOG));
+    process.start("ffmpeg", args, QIODevice::ReadOnly);
+
+    if (!process.waitForStarted(-1))
+    {
+        throw AudioDecoderException("Error starting ffmpeg");
+    }
+
+    const auto frameSize = CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8;
+
+    // Output is read into the same buffer every time rather than into a new array per read.
+    // Reads may end in the middle of a frame, whose beginning is moved to the start of the buffer for the next read
+    ScratchBuffer<char> readBuffer(PIPE_READ_BUFFER_SIZE);
+    qint64 pendingSize = 0;
+
+    // Long tracks take longer than any fixed timeout, so ffmpeg is waited for until it closes the output
+    while (process.waitForReadyRead(-1) || process.bytesAvailable() > 0)
+    {
+        while (process.bytesAvailable() > 0)
+        {
+            const auto readSize = process.read(readBuffer.data() + pendingSize, readBuffer.count() - pendingSize);
+            if (readSize <= 0)
+            {
+                throw AudioDecoderException("Error reading decoded audio from ffmpeg");
+            }
+
+            const auto dataSize = pendingSize + readSize;
+            const auto framesCount = static_cast<int>(dataSize / frameSize);
+            if (framesCount > 0)
+            {
+                stageTimer.addBytes(framesCount * frameSize);
+                stageTimer.addFrames(framesCount);
+
+                consumeBlock(reinterpret_cast<const qint16 *>(readBuffer.constData()), framesCount);
+            }
+
+            pendingSize = dataSize - framesCount * frameSize;
+            memmove(readBuffer.data(), readBuffer.constData() + framesCount * frameSize, static_cast<size_t>(pendingSize));
+        }
+    }
+
+    process.waitForFinished(-1);
+
+    if (process.exitStatus() == QProcess::CrashExit || process.exitCode() != 0)
+    {
+        throw AudioDecoderException("Error decoding media file with ffmpeg");
+    }
+}
+
+QString AudioDecoder::perThreadFilePath(const QString &filePathPattern)
+{
+    return filePathPattern.arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+}
+
+const PcmAudioData *AudioDecoder::pipedAudioToPcmByChannels(const QString &mediaFilePath) const
+{
+    QScopedPointer<PcmAudioData> pcmAudioData(createPcmAudioData());
+
+    readPipedAudio(mediaFilePath, [&](const qint16 *allChannelsData, const int framesCount) {
+        appendFrames(allChannelsData, framesCount, pcmAudioData.data());
+    });
+
+    return pcmAudioData.take();
+}
+
+const QString *AudioDecoder::mediaToAudio(const QString &mediaFilePath, const QString *audioFilePath) const
 {
     const auto sampleRate = QString::number(SAMPLE_RATE_HZ);
     const auto channelsCount = QString::number(CHANNELS_COUNT);
@@ -48,13 +208,15 @@ const QString *AudioDecoder::mediaToAudio(const QString &mediaFilePath) const
         << "-ar"    << QString::number(SAMPLE_RATE_HZ)
         << "-ac"    << QString::number(CHANNELS_COUNT)
         << "-c:a"   << DEFAULT_CODEC
-        << "-vn"    << TEMP_WAV_FILE;    // output file
+        << "-vn"    << *audioFilePath;   // output file
+
+    PipelineStats::StageTimer stageTimer(PipelineStats::MediaDecoding);
 
     QProcess process;
-    process.setStandardErrorFile("logs/ffmpeg/errors.txt");
-    process.setStandardOutputFile("logs/ffmpeg/output.txt");
+    process.setStandardErrorFile(perThreadFilePath(ERROR_LOG));
+    process.setStandardOutputFile(perThreadFilePath(OUTPUT_LOG));
     process.start("ffmpeg", args);
-    process.waitForFinished();
+    process.waitForFinished(-1);
 
     const auto exitStatus = process.exitStatus();
 
@@ -65,50 +227,105 @@ const QString *AudioDecoder::mediaToAudio(const QString &mediaFilePath) const
         throw AudioDecoderException("Error converting media file to .wav file");
     }
 
-    return &TEMP_WAV_FILE;
+    return audioFilePath;
 }
 
 const WavData *AudioDecoder::audioToRawAudioData(const QString *audioFilePath, WavData *wavData)
 {
+    PipelineStats::StageTimer stageTimer(PipelineStats::WavReading);
+
     const WavFileReader wavFileReader(*audioFilePath);
     wavFileReader.readWavData(wavData, true);
 
+    stageTimer.addBytes(wavData->audioBuffer()->size());
+    stageTimer.addFrames(wavData->audioBuffer()->size() / (CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8));
+
     return wavData;
 }
 
-const PcmAudioData *AudioDecoder::rawAudioDataToPcmByChannels(const WavData *rawAudioData) const
+const PcmAudioData *AudioDecoder::rawAudioDataToPcmByChannels(const QByteArray *audioBuffer) const
 {
-    const auto audioBuffer = rawAudioData->audioBuffer();
-    const auto audioData = const_cast<qint16 *>(reinterpret_cast<const qint16 *>(audioBuffer->constData()));
+    const auto audioData = reinterpret_cast<const qint16 *>(audioBuffer->constData());
+    const auto framesCount = audioBuffer->count() / (CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8);
 
-    const auto audioBufferSize = audioBuffer->count();
-    const quint64 samplesCount = static_cast<double>(audioBufferSize) / SAMPLE_SIZE_BITS * 8;
-    const auto framesCount = samplesCount / CHANNELS_COUNT;
+    const auto pcmAudioData = createPcmAudioData();
+    appendFrames(audioData, framesCount, pcmAudioData);
 
-    auto pcmAudioData = new PcmAudioData();
+    return pcmAudioData;
+}
 
-    const auto leftChannelData = readDataForChannel(audioData, framesCount, LEFT_CHANNEL);
-    pcmAudioData->setLeftChannelData(leftChannelData);
+PcmAudioData *AudioDecoder::createPcmAudioData() const
+{
+    const auto pcmAudioData = new PcmAudioData();
 
-    const auto rightChannelData = readDataForChannel(audioData, framesCount, LEFT_CHANNEL);
-    pcmAudioData->setRightChannelData(rightChannelData);
+    if (_downmixToMono)
+    {
+        pcmAudioData->setMonoData(new QVector<qint16>());
+    }
+    else
+    {
+        pcmAudioData->setLeftChannelData(new QVector<qint16>());
+        pcmAudioData->setRightChannelData(new QVector<qint16>());
+    }
 
     return pcmAudioData;
 }
 
-QVector<qint16> *AudioDecoder::readDataForChannel(
-    const qint16* allChannelsData,
-    const quint64 framesCount,
-    const qint8 channelNumber) const
+void AudioDecoder::appendFrames(const qint16 *allChannelsData, const int framesCount, PcmAudioData *pcmAudioData) const
 {
-    const auto dataForChannel = new QVector<qint16>(framesCount);
+    PipelineStats::StageTimer stageTimer(PipelineStats::ChannelSplit);
+    stageTimer.addBytes(framesCount * CHANNELS_COUNT * SAMPLE_SIZE_BITS / 8);
+    stageTimer.addFrames(framesCount);
 
-    for (quint64 frameNumber = 0; frameNumber < framesCount; frameNumber++) {
-        const qint64 sampleNumber = frameNumber * CHANNELS_COUNT + channelNumber;
-        const auto sample = qFromLittleEndian(allChannelsData[sampleNumber]);
+    if (_downmixToMono)
+    {
+        appendMonoData(allChannelsData, framesCount, pcmAudioData->monoData());
+    }
+    else
+    {
+        appendChannelsData(allChannelsData, framesCount, pcmAudioData->leftChannelData(), pcmAudioData->rightChannelData());
+    }
+}
 
-        (*dataForChannel)[frameNumber] = sample;
+void AudioDecoder::appendChannelsData(
+    const qint16 *allChannelsData,
+    const int framesCount,
+    QVector<qint16> *leftChannelData,
+    QVector<qint16> *rightChannelData)
+{
+    const auto offset = leftChannelData->count();
+    leftChannelData->resize(offset + framesCount);
+    rightChannelData->resize(offset + framesCount);
+
+    const auto left = leftChannelData->data() + offset;
+    const auto right = rightChannelData->data() + offset;
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // Samples are already in the host byte order, so both channels are split in a single vectorized pass
+    SimdKernels::best().deinterleaveStereo(allChannelsData, left, right, framesCount);
+#else
+    for (auto frame = 0; frame < framesCount; frame++) {
+        left[frame] = qFromLittleEndian(allChannelsData[2 * frame]);
+        right[frame] = qFromLittleEndian(allChannelsData[2 * frame + 1]);
     }
+#endif
+}
 
-    return dataForChannel;
+void AudioDecoder::appendMonoData(const qint16 *allChannelsData, const int framesCount, QVector<qint16> *monoData)
+{
+    const auto offset = monoData->count();
+    monoData->resize(offset + framesCount);
+
+    const auto mono = monoData->data() + offset;
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    SimdKernels::best().downmixStereo(allChannelsData, mono, framesCount);
+#else
+    for (auto frame = 0; frame < framesCount; frame++) {
+        const auto left = qFromLittleEndian(allChannelsData[2 * frame]);
+        const auto right = qFromLittleEndian(allChannelsData[2 * frame + 1]);
+
+        mono[frame] = static_cast<qint16>((left + right) >> 1);
+    }
+#endif
 }
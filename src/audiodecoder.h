@@ -5,6 +5,8 @@
 #include "pcmaudiodata.h"
 #include "wavdata.h"
 
+class StreamingSpectrumAnalyzer;
+
 class AudioDecoder final : public QObject
 {
     Q_OBJECT
@@ -15,21 +17,57 @@ public:
     static const int SAMPLE_SIZE_BITS;
     static const QString DEFAULT_CODEC;
 
+    // How the ffmpeg executable hands decoded audio over when the FFmpeg libraries are not linked in
+    enum FfmpegOutput
+    {
+        // Raw PCM is read from the standard output while ffmpeg is still decoding
+        PipedOutput,
+        // ffmpeg writes a temporary .wav file, which is read after it exits
+        WavFileOutput
+    };
+    Q_ENUM(FfmpegOutput)
+
     explicit AudioDecoder(QObject* pobj = nullptr);
     virtual ~AudioDecoder();
 
+    FfmpegOutput ffmpegOutput() const { return _ffmpegOutput; }
+    void setFfmpegOutput(FfmpegOutput ffmpegOutput) { _ffmpegOutput = ffmpegOutput; }
+
+    // Decoded audio is mixed down into PcmAudioData::monoData() instead of being split into channels
+    bool downmixToMono() const { return _downmixToMono; }
+    void setDownmixToMono(bool downmixToMono) { _downmixToMono = downmixToMono; }
+
     const PcmAudioData * decode(const QString &filePath) const;
 
+    // Passes the left channel, or the mono downmix, to the analyzer block by block as it is decoded,
+    // in-process when the FFmpeg libraries are linked in and by ffmpeg otherwise,
+    // so analysis overlaps with decoding and the track is never kept in memory as a whole
+    void decode(const QString &filePath, StreamingSpectrumAnalyzer *analyzer) const;
+
 private:
+    // %1 is replaced by the id of the decoding thread, so files decoded at once do not overwrite each other.
+    // Every decode starts its log files anew, which leaves the logs of the last decode of every thread
     static const QString TEMP_WAV_FILE;
     static const QString OUTPUT_LOG;
     static const QString ERROR_LOG;
+    // Decoded audio read from the ffmpeg process at once, a multiple of the frame size
+    static const int PIPE_READ_BUFFER_SIZE;
+
+    FfmpegOutput _ffmpegOutput = PipedOutput;
+
+    static QString perThreadFilePath(const QString &filePathPattern);
+    bool _downmixToMono = false;
 
-    static const qint8 LEFT_CHANNEL;
-    static const qint8 RIGHT_CHANNEL;
+    template<typename BlockConsumer>
+    void readPipedAudio(const QString &mediaFilePath, BlockConsumer consumeBlock) const;
+    const PcmAudioData *pipedAudioToPcmByChannels(const QString &mediaFilePath) const;
 
-    const QString *mediaToAudio(const QString &mediaFilePath) const;
+    const QString *mediaToAudio(const QString &mediaFilePath, const QString *audioFilePath) const;
     static const WavData *audioToRawAudioData(const QString *audioFilePath, WavData *wavData);
-    const PcmAudioData *rawAudioDataToPcmByChannels(const WavData *rawAudioData) const;
-    QVector<qint16> *readDataForChannel(const qint16* allChannelsData, quint64 framesCount, qint8 channelNumber) const;
+    const PcmAudioData *rawAudioDataToPcmByChannels(const QByteArray *audioBuffer) const;
+    PcmAudioData *createPcmAudioData() const;
+    void appendFrames(const qint16 *allChannelsData, int framesCount, PcmAudioData *pcmAudioData) const;
+    static void appendChannelsData(const qint16 *allChannelsData, int framesCount,
+                                   QVector<qint16> *leftChannelData, QVector<qint16> *rightChannelData);
+    static void appendMonoData(const qint16 *allChannelsData, int framesCount, QVector<qint16> *monoData);
 };
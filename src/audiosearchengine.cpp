@@ -1,44 +1,456 @@
 #include "audiosearchengine.h"
+#include "spectrogramfile.h"
+#include "scratcharena.h"
 
 #include <QObject>
 #include <QAudioOutput>
+#include <QDir>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QtConcurrent>
+
+const int AudioSearchEngine::DEFAULT_MAX_CONCURRENT_ANALYSES = 2;
+const quint32 AudioSearchEngine::FRAGMENT_DURATION_MS = 20;
+const int AudioSearchEngine::LIVE_SEARCH_DURATION_MS = 20000;
 
 AudioSearchEngine::AudioSearchEngine(QObject* pobj)
     : QObject(pobj)
 {
+    qRegisterMetaType<FingerprintMatch>();
+    qRegisterMetaType<PipelineStats>();
+
     _audioDecoder = new AudioDecoder(this);
+    _audioDecoder->setDownmixToMono(true);
     _spectrumAnalyzer = new SpectrumAnalyzer(this);
+    // Fingerprints depend on the band energies only, which the faster real single precision FFT barely changes,
+    // see the precision test. Both choices are part of the analysis parameters of the cache
+    _spectrumAnalyzer->setFftMode(SpectrumAnalyzer::RealFft);
+    _spectrumAnalyzer->setPrecision(SpectrumAnalyzer::SinglePrecision);
+    _analysisCache = new AnalysisCache(AnalysisCache::defaultDirectoryPath(), AnalysisCache::DEFAULT_MAX_SIZE_BYTES, this);
+    _fingerprintExtractor = new FingerprintExtractor(this);
+    _fingerprintIndex = new FingerprintIndex(this);
+    _searchedFingerprintIndex = new ShardedFingerprintIndex(this);
+    _searchedFingerprintIndex->addShard(_fingerprintIndex);
+    loadFingerprintIndex(FingerprintIndex::defaultFilePath());
+
+    _analysisThreadPool = new QThreadPool(this);
+    _analysisThreadPool->setMaxThreadCount(DEFAULT_MAX_CONCURRENT_ANALYSES);
 }
 
 AudioSearchEngine::~AudioSearchEngine()
 {
+    stopLiveSearch();
+    cancelAll();
+    _analysisThreadPool->waitForDone();
+
+    // Only tracks added since the load are written, never an index reset after a failed load
+    if (_fingerprintIndex->isModified() && !_fingerprintIndexFilePath.isEmpty())
+    {
+        saveFingerprintIndex();
+    }
+}
+
+bool AudioSearchEngine::loadFingerprintIndex(const QString &filePath)
+{
+    const auto hopSize = samplesPerFragment();
+
+    // Fingerprints of other framing can not be compared to the ones analyzed now
+    if (!_fingerprintIndex->load(filePath)
+        || _fingerprintIndex->sampleRate() != static_cast<quint32>(AudioDecoder::SAMPLE_RATE_HZ)
+        || _fingerprintIndex->hopSize() != hopSize)
+    {
+        _fingerprintIndex->clear();
+        _fingerprintIndex->setFraming(AudioDecoder::SAMPLE_RATE_HZ, hopSize);
+
+        // A file that can not be read, e.g. one of an older version, is left alone rather than overwritten.
+        // A missing one is created by the first save
+        _fingerprintIndexFilePath = QFileInfo::exists(filePath) ? QString() : filePath;
+        return false;
+    }
+
+    _fingerprintIndexFilePath = filePath;
+    return true;
+}
+
+bool AudioSearchEngine::addSearchedFingerprintIndex(const QString &filePath)
+{
+    return _searchedFingerprintIndex->loadShard(filePath);
+}
+
+bool AudioSearchEngine::saveFingerprintIndex()
+{
+    if (_fingerprintIndexFilePath.isEmpty())
+    {
+        emit error(tr("The fingerprint index is not saved, its file could not be read"));
+        return false;
+    }
+
+    QDir().mkpath(QFileInfo(_fingerprintIndexFilePath).absolutePath());
+
+    // Saving merges the pending postings, which may run out of memory. It is also called
+    // by the destructor, so nothing is thrown out of it
+    try
+    {
+        return _fingerprintIndex->save(_fingerprintIndexFilePath);
+    }
+    catch (std::exception &ex)
+    {
+        emit error(tr("Error saving the fingerprint index to %1: %2")
+                   .arg(_fingerprintIndexFilePath, QString::fromLocal8Bit(ex.what())));
+        return false;
+    }
+}
+
+PipelineStats AudioSearchEngine::pipelineStats() const
+{
+    const QMutexLocker locker(&_pipelineStatsMutex);
+    return _pipelineStats;
+}
+
+void AudioSearchEngine::resetPipelineStats()
+{
+    const QMutexLocker locker(&_pipelineStatsMutex);
+    _pipelineStats.clear();
+}
+
+bool AudioSearchEngine::pipelineTracingEnabled() const
+{
+    const QMutexLocker locker(&_pipelineStatsMutex);
+    return _pipelineTracingEnabled;
+}
+
+void AudioSearchEngine::setPipelineTracingEnabled(const bool pipelineTracingEnabled)
+{
+    const QMutexLocker locker(&_pipelineStatsMutex);
+    _pipelineTracingEnabled = pipelineTracingEnabled;
+}
+
+void AudioSearchEngine::setSpectrumWorkerCount(const int workerCount)
+{
+    _spectrumAnalyzer->setWorkerCount(workerCount);
+}
+
+int AudioSearchEngine::samplesPerFragment()
+{
+    return static_cast<int>(AudioDecoder::SAMPLE_RATE_HZ * FRAGMENT_DURATION_MS / 1000);
+}
+
+ClipSearch *AudioSearchEngine::createClipSearch(QObject *parent) const
+{
+    return new ClipSearch(_spectrumAnalyzer, _fingerprintExtractor, _searchedFingerprintIndex,
+                          AudioDecoder::SAMPLE_RATE_HZ, samplesPerFragment(), parent);
+}
+
+void AudioSearchEngine::search(const QString &clipFilePath)
+{
+    QtConcurrent::run(_analysisThreadPool, [=]() {
+        runSearch(clipFilePath);
+    });
+}
+
+void AudioSearchEngine::runSearch(const QString &clipFilePath)
+{
+    // The clip search lives on the worker thread, so its signals reach the engine through its event loop
+    const QScopedPointer<ClipSearch> clipSearch(createClipSearch());
+    connect(clipSearch.data(), &ClipSearch::matchFound, this, &AudioSearchEngine::searchMatchFound);
+    connect(clipSearch.data(), &ClipSearch::finished, this, &AudioSearchEngine::searchFinished);
+
+    try
+    {
+        // The clip is fingerprinted while ffmpeg decodes it
+        _audioDecoder->decode(clipFilePath, clipSearch->spectrumAnalyzer());
+    }
+    catch (std::exception &ex)
+    {
+        emit error(tr("Error searching by %1: %2").arg(clipFilePath, QString::fromLocal8Bit(ex.what())));
+    }
+}
+
+void AudioSearchEngine::startLiveSearch(const QAudioDeviceInfo &inputDevice)
+{
+    stopLiveSearch();
+
+    QAudioFormat format;
+    format.setSampleRate(AudioDecoder::SAMPLE_RATE_HZ);
+    format.setChannelCount(1);
+    format.setSampleSize(AudioDecoder::SAMPLE_SIZE_BITS);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(static_cast<QAudioFormat::Endian>(QSysInfo::ByteOrder));
+    format.setCodec("audio/pcm");
+
+    if (!inputDevice.isFormatSupported(format))
+    {
+        emit error(tr("%1 can not record %2 Hz mono audio").arg(inputDevice.deviceName()).arg(AudioDecoder::SAMPLE_RATE_HZ));
+        return;
+    }
+
+    _liveSearch = createClipSearch(this);
+    _audioInput = new QAudioInput(inputDevice, format, this);
+
+    const auto liveSearch = _liveSearch;
+    connect(liveSearch, &ClipSearch::matchFound, this, &AudioSearchEngine::searchMatchFound);
+    connect(liveSearch, &ClipSearch::finished, this, &AudioSearchEngine::searchFinished);
+
+    // Listening stops once the track is found, after the samples being processed now
+    connect(liveSearch, &ClipSearch::matchFound, liveSearch, [=]() {
+        QTimer::singleShot(0, liveSearch, [=]() { stopLiveSearch(); });
+    });
+    QTimer::singleShot(LIVE_SEARCH_DURATION_MS, liveSearch, [=]() { stopLiveSearch(); });
+
+    const auto inputStream = _audioInput->start();
+    if (inputStream == nullptr)
+    {
+        emit error(tr("Error starting the audio input"));
+        stopLiveSearch();
+        return;
+    }
+
+    connect(inputStream, &QIODevice::readyRead, liveSearch, [=]() {
+        const auto samples = inputStream->read(inputStream->bytesAvailable() & ~static_cast<qint64>(1));
+        liveSearch->process(reinterpret_cast<const qint16 *>(samples.constData()), samples.size() / static_cast<int>(sizeof(qint16)));
+    });
 }
 
-void AudioSearchEngine::analyze(const QString &filePath) const
+void AudioSearchEngine::stopLiveSearch()
 {
-    const auto pcmAudioData = _audioDecoder->decode(filePath);
-    const auto frequencySpectra = _spectrumAnalyzer->getFrequencySpectrogram(pcmAudioData->leftChannelData(), 25600, 20);
+    if (_liveSearch == nullptr)
+    {
+        return;
+    }
+
+    const auto liveSearch = _liveSearch;
+    _liveSearch = nullptr;
 
-    QFile file("frequencies.csv");
-    file.open(QIODevice::WriteOnly);
+    _audioInput->stop();
+    _audioInput->deleteLater();
+    _audioInput = nullptr;
+
+    // Reports the best match of everything heard
+    liveSearch->finish();
+    liveSearch->deleteLater();
+}
+
+void AudioSearchEngine::analyze(const QString &filePath)
+{
+    const auto key = jobKey(filePath);
+    const QSharedPointer<AnalysisJob> job(new AnalysisJob());
 
-    for (auto spectrum : *frequencySpectra)
     {
-        for (auto i = 0; i < 160; i++)
+        const QMutexLocker locker(&_jobsMutex);
+
+        if (_jobs.contains(key))
         {
-            file.write(QString::number((*spectrum)[i]).toStdString().c_str());
+            return;
+        }
 
-            if (i != 159)
-            {
-                file.write(", ");
-            }
-            else
+        _jobs.insert(key, job);
+    }
+
+    QtConcurrent::run(_analysisThreadPool, [=]() {
+        runAnalysis(key, job);
+    });
+}
+
+void AudioSearchEngine::cancel(const QString &filePath)
+{
+    const QMutexLocker locker(&_jobsMutex);
+
+    // The job is forgotten at once, so the file can be queued again while the canceled analysis winds down
+    const auto job = _jobs.take(jobKey(filePath));
+    if (job)
+    {
+        job->canceled.storeRelease(1);
+    }
+}
+
+void AudioSearchEngine::cancelAll()
+{
+    const QMutexLocker locker(&_jobsMutex);
+
+    for (const auto &job : _jobs)
+    {
+        job->canceled.storeRelease(1);
+    }
+
+    _jobs.clear();
+}
+
+void AudioSearchEngine::waitForDone()
+{
+    _analysisThreadPool->waitForDone();
+}
+
+bool AudioSearchEngine::isAnalyzing(const QString &filePath) const
+{
+    const QMutexLocker locker(&_jobsMutex);
+    return _jobs.contains(jobKey(filePath));
+}
+
+int AudioSearchEngine::pendingAnalysesCount() const
+{
+    const QMutexLocker locker(&_jobsMutex);
+    return _jobs.count();
+}
+
+void AudioSearchEngine::setMaxConcurrentAnalyses(const int maxConcurrentAnalyses)
+{
+    _analysisThreadPool->setMaxThreadCount(qMax(1, maxConcurrentAnalyses));
+}
+
+QString AudioSearchEngine::jobKey(const QString &filePath)
+{
+    return QFileInfo(filePath).absoluteFilePath();
+}
+
+void AudioSearchEngine::runAnalysis(const QString &filePath, const QSharedPointer<AnalysisJob> &job)
+{
+    if (job->canceled.loadAcquire())
+    {
+        emit analysisCanceled(filePath);
+        return;
+    }
+
+    emit analysisStarted(filePath);
+
+    // Every stage below runs on this thread, so their timers record into the stats of this analysis
+    PipelineStats stats(filePath, pipelineTracingEnabled());
+    const PipelineStats::Recording recording(&stats);
+
+    // Temporary buffers of the stages are freed all at once when the analysis returns
+    ScratchArena scratchArena;
+    const ScratchArena::Scope scratchScope(&scratchArena);
+
+    qint64 audioDurationMs;
+
+    try
+    {
+        Spectrogram frequencySpectrogram;
+        if (!getFrequencySpectrogram(filePath, *job, &frequencySpectrogram))
+        {
+            emit analysisCanceled(filePath);
+            return;
+        }
+
+        audioDurationMs = static_cast<qint64>(frequencySpectrogram.framesCount()) * samplesPerFragment() * 1000
+            / AudioDecoder::SAMPLE_RATE_HZ;
+
+        if (!_fingerprintIndex->contains(filePath))
+        {
+            Fingerprints fingerprints;
             {
-                file.write("\n");
+                PipelineStats::StageTimer stageTimer(PipelineStats::FingerprintExtraction);
+                fingerprints = _fingerprintExtractor->extract(frequencySpectrogram);
+                stageTimer.addFrames(frequencySpectrogram.framesCount());
             }
+
+            PipelineStats::StageTimer stageTimer(PipelineStats::IndexInsertion);
+            _fingerprintIndex->insert(filePath, fingerprints);
+            stageTimer.addBytes(fingerprints.count() * static_cast<qint64>(sizeof(FingerprintPosting)));
+            stageTimer.addFrames(frequencySpectrogram.framesCount());
         }
+
+        if (!_csvExportPath.isEmpty())
+        {
+            SpectrogramFile::exportCsv(_csvExportPath, frequencySpectrogram);
+        }
+
+        // The job is removed first, so the file can be queued again from a slot of the signal
+        removeJob(filePath, job);
+
+        // Tracks added by the whole batch are merged into the index together. Files added one by one
+        // are merged only once they make a part of the index, since every merge copies the whole of it
+        if (pendingAnalysesCount() == 0)
+        {
+            _fingerprintIndex->buildIfNeeded();
+        }
+    }
+    catch (std::exception &ex)
+    {
+        const auto errorMessage = QString::fromLocal8Bit(ex.what());
+
+        removeJob(filePath, job);
+        addPipelineStats(stats);
+        emit analysisStats(filePath, stats);
+        emit analysisFailed(filePath, errorMessage);
+        emit error(tr("Error analyzing %1: %2").arg(filePath, errorMessage));
+        return;
+    }
+
+    addPipelineStats(stats);
+
+    emit analysisProgress(filePath, 100);
+    emit analysisStats(filePath, stats);
+    emit analysisFinished(filePath, audioDurationMs);
+}
+
+void AudioSearchEngine::removeJob(const QString &filePath, const QSharedPointer<AnalysisJob> &job)
+{
+    const QMutexLocker locker(&_jobsMutex);
+
+    // A canceled job may have been replaced by a new request for the same file
+    if (_jobs.value(filePath) == job)
+    {
+        _jobs.remove(filePath);
     }
+}
+
+void AudioSearchEngine::addPipelineStats(const PipelineStats &stats)
+{
+    const QMutexLocker locker(&_pipelineStatsMutex);
+    _pipelineStats.merge(stats, _pipelineTracingEnabled);
+}
 
-    file.flush();
-    file.close();
+bool AudioSearchEngine::getFrequencySpectrogram(const QString &filePath, const AnalysisJob &job, Spectrogram *frequencySpectrogram)
+{
+    const auto parameters = analysisParameters();
+
+    if (_analysisCacheEnabled)
+    {
+        PipelineStats::StageTimer stageTimer(PipelineStats::CacheLoad);
+        if (_analysisCache->load(filePath, parameters, frequencySpectrogram))
+        {
+            stageTimer.addBytes(frequencySpectrogram->framesCount() * static_cast<qint64>(frequencySpectrogram->bandsCount()) * sizeof(quint16));
+            stageTimer.addFrames(frequencySpectrogram->framesCount());
+            return true;
+        }
+    }
+
+    const QScopedPointer<const PcmAudioData> pcmAudioData(_audioDecoder->decode(filePath));
+    if (job.canceled.loadAcquire())
+    {
+        return false;
+    }
+
+    emit analysisProgress(filePath, 50);
+
+    *frequencySpectrogram = _spectrumAnalyzer->getFrequencySpectrogram(
+        pcmAudioData->monoData(), AudioDecoder::SAMPLE_RATE_HZ, FRAGMENT_DURATION_MS);
+    if (job.canceled.loadAcquire())
+    {
+        return false;
+    }
+
+    emit analysisProgress(filePath, 90);
+
+    if (_analysisCacheEnabled)
+    {
+        PipelineStats::StageTimer stageTimer(PipelineStats::CacheStore);
+        _analysisCache->store(filePath, parameters, *frequencySpectrogram);
+        stageTimer.addBytes(frequencySpectrogram->framesCount() * static_cast<qint64>(frequencySpectrogram->bandsCount()) * sizeof(quint16));
+        stageTimer.addFrames(frequencySpectrogram->framesCount());
+    }
+
+    return true;
+}
+
+QByteArray AudioSearchEngine::analysisParameters() const
+{
+    // Everything the spectrogram depends on besides the media file itself
+    return QByteArray("mono")
+        + '/' + QByteArray::number(AudioDecoder::SAMPLE_RATE_HZ)
+        + '/' + QByteArray::number(FRAGMENT_DURATION_MS)
+        + '/' + QByteArray::number(_spectrumAnalyzer->fftMode())
+        + '/' + QByteArray::number(_spectrumAnalyzer->precision())
+        + '/' + QByteArray("amplitude-histogram");
 }
@@ -1,24 +1,155 @@
 #pragma once
 
 #include <QObject>
+#include <QAudioDeviceInfo>
+#include <QAudioInput>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
 #include "audiodecoder.h"
 #include "spectrumanalyzer.h"
+#include "analysiscache.h"
+#include "fingerprintextractor.h"
+#include "fingerprintindex.h"
+#include "shardedfingerprintindex.h"
+#include "clipsearch.h"
+#include "pipelinestats.h"
 
 class AudioSearchEngine : public QObject
 {
     Q_OBJECT
 
 public:
+    // Decoding is mostly spent waiting for ffmpeg and the FFT is parallel by itself, so few files are analyzed at once
+    static const int DEFAULT_MAX_CONCURRENT_ANALYSES;
+
     explicit AudioSearchEngine(QObject* pobj = nullptr);
     virtual ~AudioSearchEngine();
 
-    void analyze(const QString &filePath) const;
+    // Queues the analysis of the file on the worker threads and returns at once.
+    // A file that is already queued or being analyzed is not queued again
+    void analyze(const QString &filePath);
+
+    // A queued analysis is dropped, a running one stops after its current stage
+    void cancel(const QString &filePath);
+    void cancelAll();
+
+    // Blocks until every queued analysis is finished or canceled
+    void waitForDone();
+
+    bool isAnalyzing(const QString &filePath) const;
+    int pendingAnalysesCount() const;
+
+    int maxConcurrentAnalyses() const { return _analysisThreadPool->maxThreadCount(); }
+    void setMaxConcurrentAnalyses(int maxConcurrentAnalyses);
+
+    // Searches the indexed tracks for the one the clip file comes from on the worker threads.
+    // The results are reported by the search signals, the first one as soon as the match is confident
+    void search(const QString &clipFilePath);
+
+    // Listens to the audio input until the track it plays is found, stopLiveSearch() is called
+    // or LIVE_SEARCH_DURATION_MS passes. The results are reported by the search signals
+    void startLiveSearch(const QAudioDeviceInfo &inputDevice = QAudioDeviceInfo::defaultInputDevice());
+    bool isLiveSearchActive() const { return _liveSearch != nullptr; }
+
+    // Every analyzed file is added to the index, which is saved to the file it was loaded from
+    // when the engine is destroyed if files were added. A missing or incompatible file gives an empty index
+    // and false. The index is then saved to a missing file, but never over a file that could not be read
+    const FingerprintIndex *fingerprintIndex() const { return _fingerprintIndex; }
+    bool loadFingerprintIndex(const QString &filePath);
+    bool saveFingerprintIndex();
+    // Empty if the index file could not be read
+    QString fingerprintIndexFilePath() const { return _fingerprintIndexFilePath; }
+
+    // Searches the index file, e.g. a shard built on another machine, together with the own index.
+    // Returns false if it is missing, damaged or analyzed with other parameters
+    bool addSearchedFingerprintIndex(const QString &filePath);
+
+    // Spectrograms of analyzed files are kept in the on-disk cache, which batch indexing of a library
+    // larger than the cache only wears out
+    bool analysisCacheEnabled() const { return _analysisCacheEnabled; }
+    void setAnalysisCacheEnabled(bool analysisCacheEnabled) { _analysisCacheEnabled = analysisCacheEnabled; }
+
+    // Threads calculating the spectrogram of every analyzed file, see SpectrumAnalyzer::setWorkerCount()
+    void setSpectrumWorkerCount(int workerCount);
+
+    // Measurements of every stage of all analyses since the engine was created or the stats were reset.
+    // Trace events are collected only while tracing is enabled, since they grow with every analyzed file
+    PipelineStats pipelineStats() const;
+    void resetPipelineStats();
+    bool pipelineTracingEnabled() const;
+    void setPipelineTracingEnabled(bool pipelineTracingEnabled);
+
+    // Debugging aid: every analyzed spectrogram is written to the CSV file when the path is set
+    QString csvExportPath() const { return _csvExportPath; }
+    void setCsvExportPath(const QString &csvExportPath) { _csvExportPath = csvExportPath; }
 
 signals:
+    // Analysis signals are emitted from the worker threads and carry the absolute path of the file
+    void analysisStarted(const QString &filePath);
+    void analysisProgress(const QString &filePath, int percent);
+    void analysisFinished(const QString &filePath, qint64 audioDurationMs);
+    void analysisFailed(const QString &filePath, const QString &errorMessage);
+    void analysisCanceled(const QString &filePath);
+    // Emitted before analysisFinished() or analysisFailed() with the measurements of the analysis
+    void analysisStats(const QString &filePath, const PipelineStats &stats);
+
+    // Search signals are emitted on the thread of the engine
+    void searchMatchFound(const FingerprintMatch &match, double confidence, qint64 latencyMs);
+    void searchFinished(const FingerprintMatch &bestMatch, double confidence);
+
     void error(const QString &errorMessage);
 
+public slots:
+    void stopLiveSearch();
+
 private:
-    QString _searchRequest = "";
+    struct AnalysisJob
+    {
+        QAtomicInt canceled;
+    };
+
+    static const quint32 FRAGMENT_DURATION_MS;
+    static const int LIVE_SEARCH_DURATION_MS;
+
+    QString _csvExportPath;
     AudioDecoder *_audioDecoder = nullptr;
     SpectrumAnalyzer *_spectrumAnalyzer = nullptr;
+    AnalysisCache *_analysisCache = nullptr;
+    FingerprintExtractor *_fingerprintExtractor = nullptr;
+    FingerprintIndex *_fingerprintIndex = nullptr;
+    // The own index followed by the added ones
+    ShardedFingerprintIndex *_searchedFingerprintIndex = nullptr;
+    QString _fingerprintIndexFilePath;
+    bool _analysisCacheEnabled = true;
+
+    QThreadPool *_analysisThreadPool = nullptr;
+    mutable QMutex _jobsMutex;
+    // Queued and running analyses by the absolute paths of their files
+    QHash<QString, QSharedPointer<AnalysisJob>> _jobs;
+
+    mutable QMutex _pipelineStatsMutex;
+    PipelineStats _pipelineStats;
+    bool _pipelineTracingEnabled = false;
+
+    QAudioInput *_audioInput = nullptr;
+    ClipSearch *_liveSearch = nullptr;
+
+    static QString jobKey(const QString &filePath);
+
+    static int samplesPerFragment();
+
+    ClipSearch *createClipSearch(QObject *parent = nullptr) const;
+    void runSearch(const QString &clipFilePath);
+
+    void runAnalysis(const QString &filePath, const QSharedPointer<AnalysisJob> &job);
+    void removeJob(const QString &filePath, const QSharedPointer<AnalysisJob> &job);
+    void addPipelineStats(const PipelineStats &stats);
+
+    // Spectrogram of the file from the cache, or from decoding and analyzing it if there is none.
+    // Returns false if the job was canceled in the meantime
+    bool getFrequencySpectrogram(const QString &filePath, const AnalysisJob &job, Spectrogram *frequencySpectrogram);
+    QByteArray analysisParameters() const;
 };
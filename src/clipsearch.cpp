@@ -0,0 +1,118 @@
+#include "clipsearch.h"
+
+ClipSearch::ClipSearch(
+    const SpectrumAnalyzer *spectrumAnalyzer,
+    const FingerprintExtractor *fingerprintExtractor,
+    const ShardedFingerprintIndex *fingerprintIndex,
+    const quint32 sampleRate,
+    const int samplesPerFragment,
+    QObject *parent)
+    : QObject(parent),
+      _fingerprintExtractor(fingerprintExtractor),
+      _fingerprintIndex(fingerprintIndex),
+      _spectrogram(0, SpectrumAnalyzer::energySpectrumSize()),
+      _bestMatch()
+{
+    // Fragments are framed the same way as the ones of the indexed tracks
+    _spectrumAnalyzer = new StreamingSpectrumAnalyzer(spectrumAnalyzer, sampleRate, samplesPerFragment, samplesPerFragment,
+                                                      StftFramer::RectangularWindow, this);
+    _spectrogram.setFraming(sampleRate, samplesPerFragment, samplesPerFragment);
+
+    connect(_spectrumAnalyzer, &StreamingSpectrumAnalyzer::energySpectrumReady, this, &ClipSearch::appendEnergySpectrum);
+    connect(_spectrumAnalyzer, &StreamingSpectrumAnalyzer::finished, this, &ClipSearch::finishFingerprints);
+
+    _elapsedTimer.start();
+}
+
+ClipSearch::~ClipSearch()
+{
+}
+
+void ClipSearch::process(const qint16 *samples, const int count)
+{
+    _spectrumAnalyzer->process(samples, count);
+}
+
+void ClipSearch::finish()
+{
+    _spectrumAnalyzer->finish();
+}
+
+void ClipSearch::appendEnergySpectrum(const qint64 frameIndex, const QVector<quint16> &energySpectrum)
+{
+    Q_UNUSED(frameIndex);
+
+    _spectrogram.appendRow(energySpectrum.constData());
+
+    // Peaks are final once their neighbourhood arrived
+    findPeaks(_spectrogram.framesCount() - FingerprintExtractor::peakLookaheadFrames());
+
+    // Fingerprints of a peak are final once the peaks of its target zone are found
+    auto hashablePeaksCount = _hashedPeaksCount;
+    while (hashablePeaksCount < _peaks.count()
+           && _peaks[hashablePeaksCount].frame + FingerprintExtractor::hashLookaheadFrames() < _peakFramesCount)
+    {
+        hashablePeaksCount++;
+    }
+
+    hashPeaks(hashablePeaksCount);
+
+    if (!_matchReported && _spectrogram.framesCount() - _lastQueryFramesCount >= QUERY_INTERVAL_FRAMES)
+    {
+        query();
+    }
+}
+
+void ClipSearch::finishFingerprints()
+{
+    findPeaks(_spectrogram.framesCount());
+    hashPeaks(_peaks.count());
+
+    query();
+
+    emit finished(_bestMatch, _confidence);
+}
+
+void ClipSearch::findPeaks(const int framesCount)
+{
+    if (framesCount > _peakFramesCount)
+    {
+        _fingerprintExtractor->findPeaks(_spectrogram, _peakFramesCount, framesCount, &_peaks);
+        _peakFramesCount = framesCount;
+    }
+}
+
+void ClipSearch::hashPeaks(const int peaksCount)
+{
+    if (peaksCount > _hashedPeaksCount)
+    {
+        _fingerprintExtractor->hashPeaks(_peaks, _hashedPeaksCount, peaksCount, &_fingerprints);
+        _hashedPeaksCount = peaksCount;
+    }
+}
+
+void ClipSearch::query()
+{
+    _lastQueryFramesCount = _spectrogram.framesCount();
+
+    const auto matches = _fingerprintIndex->search(_fingerprints, 2, &_votes);
+    _fingerprints.clear();
+
+    if (matches.isEmpty())
+    {
+        return;
+    }
+
+    const auto bestVotes = matches[0].votes;
+    const auto secondVotes = matches.count() > 1 ? matches[1].votes : 0;
+
+    _bestMatch = matches[0];
+    _confidence = qMin(1.0, static_cast<double>(bestVotes) / MIN_MATCH_VOTES)
+        * (1.0 - static_cast<double>(secondVotes) / bestVotes);
+
+    if (!_matchReported && bestVotes >= MIN_MATCH_VOTES && bestVotes >= MIN_VOTES_RATIO * secondVotes)
+    {
+        _matchReported = true;
+        emit matchFound(_bestMatch, _confidence, _elapsedTimer.elapsed());
+    }
+}
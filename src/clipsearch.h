@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include "fingerprintextractor.h"
+#include "shardedfingerprintindex.h"
+#include "streamingspectrumanalyzer.h"
+
+// Searches the index for the track a clip comes from while the clip is still arriving,
+// e.g. from a microphone or from a clip file being decoded. Fingerprints are extracted as soon as
+// the frames they depend on arrive, and the index is queried every QUERY_INTERVAL_FRAMES frames,
+// so a confident match is reported after a few seconds instead of at the end of the clip.
+// Every query looks up only the new fingerprints and adds their votes to the ones of the earlier queries.
+class ClipSearch : public QObject
+{
+    Q_OBJECT
+
+public:
+    // The spectrum analyzer, extractor and index have to be the ones the indexed tracks were analyzed with
+    ClipSearch(const SpectrumAnalyzer *spectrumAnalyzer, const FingerprintExtractor *fingerprintExtractor,
+               const ShardedFingerprintIndex *fingerprintIndex, quint32 sampleRate, int samplesPerFragment,
+               QObject *parent = nullptr);
+    ~ClipSearch();
+
+    // Analyzer of the clip, to be fed with mono samples directly, e.g. by AudioDecoder
+    StreamingSpectrumAnalyzer *spectrumAnalyzer() const { return _spectrumAnalyzer; }
+
+    void process(const qint16 *samples, int count);
+    void finish();
+
+    bool hasMatch() const { return _matchReported; }
+    FingerprintMatch bestMatch() const { return _bestMatch; }
+
+    // 1 when the best track has enough aligned fingerprints and no other track comes close
+    double confidence() const { return _confidence; }
+
+signals:
+    // Emitted once, as soon as the best track is confident enough. latencyMs is counted from the construction
+    void matchFound(const FingerprintMatch &match, double confidence, qint64 latencyMs);
+
+    // The best match of the whole clip, with an empty track path if nothing was found
+    void finished(const FingerprintMatch &bestMatch, double confidence);
+
+private slots:
+    void appendEnergySpectrum(qint64 frameIndex, const QVector<quint16> &energySpectrum);
+    void finishFingerprints();
+
+private:
+    // Half a second of 20 ms frames
+    static const int QUERY_INTERVAL_FRAMES = 25;
+    // Votes of the best track needed for a match, and how many times it has to outvote the second best
+    static const int MIN_MATCH_VOTES = 20;
+    static const int MIN_VOTES_RATIO = 2;
+
+    const FingerprintExtractor *_fingerprintExtractor = nullptr;
+    const ShardedFingerprintIndex *_fingerprintIndex = nullptr;
+    StreamingSpectrumAnalyzer *_spectrumAnalyzer = nullptr;
+
+    Spectrogram _spectrogram;
+    QVector<SpectralPeak> _peaks;
+    // Frames whose peaks are found and peaks whose fingerprints are extracted
+    int _peakFramesCount = 0;
+    int _hashedPeaksCount = 0;
+    // Fingerprints extracted since the last query, and the votes of the ones queried before
+    Fingerprints _fingerprints;
+    ShardedFingerprintIndex::Votes _votes;
+
+    int _lastQueryFramesCount = 0;
+    FingerprintMatch _bestMatch;
+    double _confidence = 0.0;
+    bool _matchReported = false;
+    QElapsedTimer _elapsedTimer;
+
+    void findPeaks(int framesCount);
+    void hashPeaks(int peaksCount);
+    void query();
+};
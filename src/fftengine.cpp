@@ -0,0 +1,119 @@
+#include "fftengine.h"
+#include "spectrumanalyzerexception.h"
+
+#include <qmath.h>
+
+template<typename T>
+FftEngine<T>::FftEngine(const int size, const SimdKernels &kernels)
+    : _size(size),
+      _kernels(&kernels.forType<T>())
+{
+    if (!isPowerOfTwo(size))
+    {
+        throw SpectrumAnalyzerException("FFT size should be a power of 2");
+    }
+
+    _twiddles.resize(qMax(size - 1, 0));
+    for (auto halfLength = 1; halfLength < size; halfLength <<= 1)
+    {
+        for (auto k = 0; k < halfLength; k++)
+        {
+            const auto angle = -M_PI * k / halfLength;
+            _twiddles[halfLength - 1 + k] = Complex(cos(angle), sin(angle));
+        }
+    }
+
+    auto bits = 0;
+    while ((1 << bits) < size)
+    {
+        bits++;
+    }
+
+    for (auto i = 0; i < size; i++)
+    {
+        auto reversed = 0;
+        for (auto bit = 0; bit < bits; bit++)
+        {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+
+        if (i < reversed)
+        {
+            _bitReversalSwaps.append(qMakePair(i, reversed));
+        }
+    }
+}
+
+template<typename T>
+void FftEngine<T>::transform(Complex *data) const
+{
+    reorderBitReversed(data);
+
+    if (_size < 4)
+    {
+        if (_size == 2)
+        {
+            radix2Pass(data, 1);
+        }
+
+        return;
+    }
+
+    // The first two radix-2 stages only need multiplications by 1 and -i,
+    // so they are merged into a single radix-4 pass without twiddle lookups
+    radix4FirstPass(data);
+
+    for (auto halfLength = 4; halfLength < _size; halfLength <<= 1)
+    {
+        radix2Pass(data, halfLength);
+    }
+}
+
+template<typename T>
+void FftEngine<T>::reorderBitReversed(Complex *data) const
+{
+    for (const auto &swap : _bitReversalSwaps)
+    {
+        std::swap(data[swap.first], data[swap.second]);
+    }
+}
+
+template<typename T>
+void FftEngine<T>::radix4FirstPass(Complex *data) const
+{
+    for (auto i = 0; i < _size; i += 4)
+    {
+        const auto a0 = data[i];
+        const auto a1 = data[i + 1];
+        const auto a2 = data[i + 2];
+        const auto a3 = data[i + 3];
+
+        const auto b0 = a0 + a1;
+        const auto b1 = a0 - a1;
+        const auto b2 = a2 + a3;
+        const auto b3 = a2 - a3;
+
+        // b3 * (-i)
+        const Complex b3Rotated(b3.imag(), -b3.real());
+
+        data[i] = b0 + b2;
+        data[i + 1] = b1 + b3Rotated;
+        data[i + 2] = b0 - b2;
+        data[i + 3] = b1 - b3Rotated;
+    }
+}
+
+template<typename T>
+void FftEngine<T>::radix2Pass(Complex *data, const int halfLength) const
+{
+    const auto length = halfLength << 1;
+    const auto twiddles = _twiddles.constData() + halfLength - 1;
+
+    for (auto start = 0; start < _size; start += length)
+    {
+        _kernels->butterfly(data + start, data + start + halfLength, twiddles, halfLength);
+    }
+}
+
+template class FftEngine<double>;
+template class FftEngine<float>;
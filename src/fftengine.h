@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QPair>
+#include <QVector>
+#include "simdkernels.h"
+
+// Iterative in-place radix-2 FFT for a fixed power-of-two size in double or single precision.
+// Twiddle factors and the bit-reversal permutation are computed once in the
+// constructor, so transform() performs no allocations and no calls to exp().
+// Butterflies run on the given kernels, the fastest ones for the CPU by default.
+template<typename T>
+class FftEngine final
+{
+public:
+    typedef std::complex<T> Complex;
+
+    explicit FftEngine(int size, const SimdKernels &kernels = SimdKernels::best());
+
+    int size() const { return _size; }
+
+    void transform(Complex *data) const;
+
+private:
+    int _size;
+    const SimdKernelTable<T> *_kernels;
+
+    // Twiddles of every pass stored contiguously, so butterflies read them sequentially:
+    // the pass combining halves of length h uses e^(-pi*i*k/h), k in [0, h), starting at index h - 1
+    QVector<Complex> _twiddles;
+
+    // Index pairs (i, j), i < j, which have to be swapped to put the input into bit-reversed order
+    QVector<QPair<int, int>> _bitReversalSwaps;
+
+    void reorderBitReversed(Complex *data) const;
+    void radix4FirstPass(Complex *data) const;
+    void radix2Pass(Complex *data, int halfLength) const;
+};
+
+inline bool isPowerOfTwo(const int n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
@@ -0,0 +1,47 @@
+#include "fftplan.h"
+
+template<typename T>
+FftPlan<T>::FftPlan(const FftPlanKey &key)
+    : _key(key)
+{
+    if (key.realInput)
+    {
+        _realFftEngine.reset(new RealFftEngine<T>(key.size));
+        _complexBuffer.resize(_realFftEngine->spectrumSize());
+    }
+    else
+    {
+        _fftEngine.reset(new FftEngine<T>(key.size));
+        _complexBuffer.resize(key.size);
+    }
+
+    const auto windowCoefficients = StftFramer::windowCoefficients(key.window, key.size);
+    if (!windowCoefficients.isEmpty())
+    {
+        _window.resize(key.size);
+
+        for (auto i = 0; i < key.size; i++)
+        {
+            _window[i] = static_cast<T>(windowCoefficients[i]);
+        }
+    }
+
+    // The second half of the spectrum mirrors the first one, so only size/2 bins are analyzed
+    _amplitudeBuffer.resize(key.size >> 1);
+}
+
+template<typename T>
+void FftPlan<T>::transform()
+{
+    if (_key.realInput)
+    {
+        _realFftEngine->transform(_complexBuffer.data());
+    }
+    else
+    {
+        _fftEngine->transform(_complexBuffer.data());
+    }
+}
+
+template class FftPlan<double>;
+template class FftPlan<float>;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QHash>
+#include <QScopedPointer>
+#include "fftengine.h"
+#include "realfftengine.h"
+#include "stftframer.h"
+
+struct FftPlanKey
+{
+    int size;
+    quint32 sampleRate;
+    bool realInput;
+    StftFramer::WindowFunction window;
+};
+
+inline bool operator==(const FftPlanKey &left, const FftPlanKey &right)
+{
+    return left.size == right.size && left.sampleRate == right.sampleRate
+        && left.realInput == right.realInput && left.window == right.window;
+}
+
+inline uint qHash(const FftPlanKey &key, uint seed = 0)
+{
+    return qHash(key.size, seed) ^ qHash(key.sampleRate, seed)
+        ^ static_cast<uint>(key.realInput) ^ (static_cast<uint>(key.window) << 1);
+}
+
+// Everything that a fragment of a fixed size needs to be analyzed in the precision T:
+// the FFT engine with its twiddle tables and bit-reversal permutation, the window
+// coefficients and the scratch buffers.
+// Plans are expensive to build, so SpectrumAnalyzer keeps them for reuse.
+// A plan must not be used by several threads at once because of its scratch buffers.
+template<typename T>
+class FftPlan final
+{
+public:
+    typedef std::complex<T> Complex;
+
+    explicit FftPlan(const FftPlanKey &key);
+    FftPlan(const FftPlan &) = delete;
+    FftPlan &operator=(const FftPlan &) = delete;
+
+    const FftPlanKey &key() const { return _key; }
+    int size() const { return _key.size; }
+
+    // Window coefficients of a fragment, empty for the rectangular window
+    const QVector<T> &window() const { return _window; }
+
+    Complex *complexBuffer() { return _complexBuffer.data(); }
+    QVector<float> *amplitudeBuffer() { return &_amplitudeBuffer; }
+
+    // Transforms the content of complexBuffer() in place
+    void transform();
+
+private:
+    FftPlanKey _key;
+
+    QScopedPointer<const FftEngine<T>> _fftEngine;
+    QScopedPointer<const RealFftEngine<T>> _realFftEngine;
+    QVector<T> _window;
+
+    QVector<Complex> _complexBuffer;
+    QVector<float> _amplitudeBuffer;
+};
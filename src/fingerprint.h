@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QVector>
+
+// Hash of a pair of spectral peaks anchored at a frame of a spectrogram.
+// The band of the anchor peak, the band of the target peak relative to it and the frames between the peaks
+// are packed and mixed, so equal hashes mean equal peak pairs and hashes are spread evenly over all 32 bits.
+struct Fingerprint
+{
+    quint32 hash;
+    quint32 frame;
+};
+Q_DECLARE_TYPEINFO(Fingerprint, Q_PRIMITIVE_TYPE);
+
+typedef QVector<Fingerprint> Fingerprints;
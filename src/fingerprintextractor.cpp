@@ -0,0 +1,157 @@
+#include "fingerprintextractor.h"
+#include "scratcharena.h"
+
+#include <QVarLengthArray>
+#include <algorithm>
+
+FingerprintExtractor::FingerprintExtractor(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FingerprintExtractor::~FingerprintExtractor()
+{
+}
+
+Fingerprints FingerprintExtractor::extract(const Spectrogram &spectrogram) const
+{
+    QVector<SpectralPeak> peaks;
+    findPeaks(spectrogram, 0, spectrogram.framesCount(), &peaks);
+
+    Fingerprints fingerprints;
+    fingerprints.reserve(peaks.count() * FAN_OUT);
+    hashPeaks(peaks, 0, peaks.count(), &fingerprints);
+
+    return fingerprints;
+}
+
+void FingerprintExtractor::findPeaks(const Spectrogram &spectrogram, const int beginFrame, const int endFrame,
+                                     QVector<SpectralPeak> *peaks) const
+{
+    const auto bandsCount = spectrogram.bandsCount();
+    Q_ASSERT(bandsCount <= MAX_BANDS_COUNT);
+
+    if (beginFrame >= endFrame)
+    {
+        return;
+    }
+
+    // Maxima over the band neighbourhood are calculated once for every row the time neighbourhoods cover
+    const auto firstRow = qMax(0, beginFrame - PEAK_NEIGHBOURHOOD_FRAMES);
+    const auto lastRow = qMin(spectrogram.framesCount() - 1, endFrame - 1 + PEAK_NEIGHBOURHOOD_FRAMES);
+
+    ScratchBuffer<quint16> bandMaxima((lastRow - firstRow + 1) * bandsCount);
+    for (auto row = firstRow; row <= lastRow; row++)
+    {
+        calculateBandMaxima(spectrogram.row(row), bandsCount, bandMaxima.data() + (row - firstRow) * bandsCount);
+    }
+
+    QVarLengthArray<quint16, MAX_BANDS_COUNT> neighbourhoodMaxima(bandsCount);
+    QVarLengthArray<SpectralPeak, MAX_BANDS_COUNT> framePeaks;
+
+    for (auto frame = beginFrame; frame < endFrame; frame++)
+    {
+        const auto fromRow = qMax(firstRow, frame - PEAK_NEIGHBOURHOOD_FRAMES);
+        const auto toRow = qMin(lastRow, frame + PEAK_NEIGHBOURHOOD_FRAMES);
+
+        std::fill(neighbourhoodMaxima.begin(), neighbourhoodMaxima.end(), 0);
+        for (auto row = fromRow; row <= toRow; row++)
+        {
+            const auto rowMaxima = bandMaxima.constData() + (row - firstRow) * bandsCount;
+            for (auto band = 0; band < bandsCount; band++)
+            {
+                neighbourhoodMaxima[band] = qMax(neighbourhoodMaxima[band], rowMaxima[band]);
+            }
+        }
+
+        const auto energySpectrum = spectrogram.row(frame);
+
+        framePeaks.clear();
+        for (auto band = 0; band < bandsCount; band++)
+        {
+            const auto energy = energySpectrum[band];
+            if (energy >= MIN_PEAK_ENERGY && energy == neighbourhoodMaxima[band])
+            {
+                framePeaks.append({frame, band, energy});
+            }
+        }
+
+        if (framePeaks.count() > MAX_PEAKS_PER_FRAME)
+        {
+            std::partial_sort(framePeaks.begin(), framePeaks.begin() + MAX_PEAKS_PER_FRAME, framePeaks.end(),
+                              [](const SpectralPeak &a, const SpectralPeak &b) { return a.energy > b.energy; });
+            framePeaks.resize(MAX_PEAKS_PER_FRAME);
+            std::sort(framePeaks.begin(), framePeaks.end(),
+                      [](const SpectralPeak &a, const SpectralPeak &b) { return a.band < b.band; });
+        }
+
+        for (const auto &peak : framePeaks)
+        {
+            peaks->append(peak);
+        }
+    }
+}
+
+void FingerprintExtractor::hashPeaks(const QVector<SpectralPeak> &peaks, const int beginPeak, const int endPeak,
+                                     Fingerprints *fingerprints) const
+{
+    const auto peaksCount = peaks.count();
+
+    for (auto anchorIndex = beginPeak; anchorIndex < endPeak; anchorIndex++)
+    {
+        const auto &anchor = peaks[anchorIndex];
+        auto pairsCount = 0;
+
+        for (auto targetIndex = anchorIndex + 1; targetIndex < peaksCount && pairsCount < FAN_OUT; targetIndex++)
+        {
+            const auto &target = peaks[targetIndex];
+            const auto frameDelta = target.frame - anchor.frame;
+
+            if (frameDelta > TARGET_ZONE_END_FRAMES)
+            {
+                break;
+            }
+
+            if (frameDelta < TARGET_ZONE_BEGIN_FRAMES || qAbs(target.band - anchor.band) > TARGET_ZONE_BANDS)
+            {
+                continue;
+            }
+
+            fingerprints->append({hashPeakPair(anchor, target), static_cast<quint32>(anchor.frame)});
+            pairsCount++;
+        }
+    }
+}
+
+void FingerprintExtractor::calculateBandMaxima(const quint16 *energySpectrum, const int bandsCount, quint16 *bandMaxima)
+{
+    for (auto band = 0; band < bandsCount; band++)
+    {
+        const auto fromBand = qMax(0, band - PEAK_NEIGHBOURHOOD_BANDS);
+        const auto toBand = qMin(bandsCount - 1, band + PEAK_NEIGHBOURHOOD_BANDS);
+
+        bandMaxima[band] = *std::max_element(energySpectrum + fromBand, energySpectrum + toBand + 1);
+    }
+}
+
+quint32 FingerprintExtractor::hashPeakPair(const SpectralPeak &anchor, const SpectralPeak &target)
+{
+    static_assert(TARGET_ZONE_END_FRAMES < 1 << FRAME_DELTA_BITS, "Frame delta does not fit its field");
+    static_assert(2 * TARGET_ZONE_BANDS < 1 << BAND_OFFSET_BITS, "Band offset does not fit its field");
+    static_assert(MAX_BANDS_COUNT <= 1 << (32 - BAND_OFFSET_BITS - FRAME_DELTA_BITS), "Anchor band does not fit its field");
+
+    // The anchor band, the band of the target relative to the anchor and the frames between them take 21 bits
+    auto hash = static_cast<quint32>(anchor.band) << (BAND_OFFSET_BITS + FRAME_DELTA_BITS)
+        | static_cast<quint32>(target.band - anchor.band + TARGET_ZONE_BANDS) << FRAME_DELTA_BITS
+        | static_cast<quint32>(target.frame - anchor.frame);
+
+    // The finalizer of MurmurHash3 spreads them evenly over all 32 bits, as the buckets of the index expect.
+    // It is a bijection, so distinct peak pairs still get distinct hashes
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35;
+    hash ^= hash >> 16;
+
+    return hash;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include "fingerprint.h"
+#include "spectrogram.h"
+
+struct SpectralPeak
+{
+    int frame;
+    int band;
+    quint16 energy;
+};
+Q_DECLARE_TYPEINFO(SpectralPeak, Q_PRIMITIVE_TYPE);
+
+// Turns spectrograms into constellations of local energy peaks and hashes pairs of nearby peaks,
+// so audio is matched by comparing integers instead of spectra.
+// The parameters are fixed, since fingerprints of the library and of search requests have to be comparable.
+class FingerprintExtractor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FingerprintExtractor(QObject *parent = nullptr);
+    ~FingerprintExtractor();
+
+    // Fingerprints of the whole spectrogram ordered by frame
+    Fingerprints extract(const Spectrogram &spectrogram) const;
+
+    // Appends the peaks of frames [beginFrame, endFrame) ordered by frame and band.
+    // Peaks of a frame are final once peakLookaheadFrames() frames after it are in the spectrogram
+    void findPeaks(const Spectrogram &spectrogram, int beginFrame, int endFrame, QVector<SpectralPeak> *peaks) const;
+
+    // Appends the fingerprints anchored at peaks [beginPeak, endPeak) of the ordered peaks.
+    // Fingerprints of a peak are final once the peaks of hashLookaheadFrames() frames after it are found
+    void hashPeaks(const QVector<SpectralPeak> &peaks, int beginPeak, int endPeak, Fingerprints *fingerprints) const;
+
+    static int peakLookaheadFrames() { return PEAK_NEIGHBOURHOOD_FRAMES; }
+    static int hashLookaheadFrames() { return TARGET_ZONE_END_FRAMES; }
+
+private:
+    // A peak is the strongest energy within this many frames and bands around it
+    static const int PEAK_NEIGHBOURHOOD_FRAMES = 5;
+    static const int PEAK_NEIGHBOURHOOD_BANDS = 8;
+    // Quieter peaks are mostly noise
+    static const quint16 MIN_PEAK_ENERGY = 8;
+    // Only the strongest peaks of every frame are kept, which bounds the fingerprints per second
+    static const int MAX_PEAKS_PER_FRAME = 3;
+
+    // Peaks are paired with the first FAN_OUT peaks of the target zone following them
+    static const int TARGET_ZONE_BEGIN_FRAMES = 1;
+    static const int TARGET_ZONE_END_FRAMES = 50;
+    static const int TARGET_ZONE_BANDS = 32;
+    static const int FAN_OUT = 5;
+
+    static const int MAX_BANDS_COUNT = 256;
+
+    // Widths of the fields of a peak pair before it is hashed
+    static const int FRAME_DELTA_BITS = 6;
+    static const int BAND_OFFSET_BITS = 7;
+
+    static void calculateBandMaxima(const quint16 *energySpectrum, int bandsCount, quint16 *bandMaxima);
+    static quint32 hashPeakPair(const SpectralPeak &anchor, const SpectralPeak &target);
+};
@@ -0,0 +1,699 @@
+#include "fingerprintindex.h"
+
+#include <QMultiHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <algorithm>
+
+// "VSPI" when read in the byte order of the host that wrote the file
+static const quint32 FINGERPRINT_INDEX_MAGIC = 0x49505356;
+
+// 64 bytes, followed by the track paths, the bucket offsets, the lower halves of the hashes and the postings.
+// Every section starts at the offset the header gives for it, aligned to 8 bytes
+struct FingerprintIndex::Header
+{
+    quint32     magic;
+    quint16     version;
+    quint16     bucketBits;
+    quint32     sampleRate;
+    quint32     hopSize;
+    quint32     tracksCount;
+    quint32     reserved;
+    quint64     postingsCount;
+    quint64     tracksOffset;
+    quint64     bucketOffsetsOffset;
+    quint64     lowHashesOffset;
+    quint64     postingsOffset;
+};
+
+const quint16 FingerprintIndex::VERSION = 2;
+
+static qint64 alignedOffset(const qint64 offset)
+{
+    return (offset + 7) & ~static_cast<qint64>(7);
+}
+
+FingerprintIndex::FingerprintIndex(QObject *parent)
+    : QObject(parent)
+{
+    clearPostings();
+}
+
+FingerprintIndex::~FingerprintIndex()
+{
+    unmap();
+}
+
+QString FingerprintIndex::defaultFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/fingerprints.index";
+}
+
+quint32 FingerprintIndex::sampleRate() const
+{
+    const QReadLocker locker(&_lock);
+    return _sampleRate;
+}
+
+int FingerprintIndex::hopSize() const
+{
+    const QReadLocker locker(&_lock);
+    return _hopSize;
+}
+
+void FingerprintIndex::setFraming(const quint32 sampleRate, const int hopSize)
+{
+    const QWriteLocker locker(&_lock);
+    _sampleRate = sampleRate;
+    _hopSize = hopSize;
+}
+
+int FingerprintIndex::tracksCount() const
+{
+    const QReadLocker locker(&_lock);
+    return _trackPaths.count();
+}
+
+qint64 FingerprintIndex::postingsCount() const
+{
+    const QReadLocker locker(&_lock);
+    return _postingsCount + static_cast<qint64>(_pendingPostings.size());
+}
+
+bool FingerprintIndex::contains(const QString &trackPath) const
+{
+    const QReadLocker locker(&_lock);
+    return _trackIds.contains(trackPath);
+}
+
+QString FingerprintIndex::trackPath(const quint32 trackId) const
+{
+    const QReadLocker locker(&_lock);
+    return _trackPaths.value(static_cast<int>(trackId));
+}
+
+quint32 FingerprintIndex::insert(const QString &trackPath, const Fingerprints &fingerprints)
+{
+    const QWriteLocker locker(&_lock);
+
+    const auto existingTrack = _trackIds.constFind(trackPath);
+    if (existingTrack != _trackIds.constEnd())
+    {
+        return existingTrack.value();
+    }
+
+    const auto trackId = static_cast<quint32>(_trackPaths.count());
+    _trackPaths.append(trackPath);
+    _trackIds.insert(trackPath, trackId);
+
+    for (const auto &fingerprint : fingerprints)
+    {
+        _pendingPostings.push_back({fingerprint.hash, {trackId, fingerprint.frame}});
+    }
+
+    _modified = true;
+
+    return trackId;
+}
+
+void FingerprintIndex::build()
+{
+    const QWriteLocker locker(&_lock);
+    mergePendingPostings();
+}
+
+void FingerprintIndex::buildIfNeeded()
+{
+    const QWriteLocker locker(&_lock);
+
+    if (static_cast<qint64>(_pendingPostings.size()) * PENDING_POSTINGS_DIVISOR >= _postingsCount)
+    {
+        mergePendingPostings();
+    }
+}
+
+QVector<FingerprintMatch> FingerprintIndex::search(const Fingerprints &clipFingerprints, const int maxMatches) const
+{
+    const QReadLocker locker(&_lock);
+
+    QHash<quint64, int> votes;
+    addVotes(clipFingerprints, &votes);
+
+    // Only the best aligned frame difference of every track counts, kept as the votes and the difference
+    QHash<quint32, QPair<int, qint32>> bestFrameDeltas;
+    for (auto it = votes.constBegin(); it != votes.constEnd(); ++it)
+    {
+        const auto trackId = static_cast<quint32>(it.key() >> 32);
+        const auto frameDelta = static_cast<qint32>(static_cast<quint32>(it.key()));
+
+        const auto best = bestFrameDeltas.constFind(trackId);
+        if (best == bestFrameDeltas.constEnd() || it.value() > best.value().first)
+        {
+            bestFrameDeltas.insert(trackId, qMakePair(it.value(), frameDelta));
+        }
+    }
+
+    QVector<FingerprintMatch> matches;
+    matches.reserve(bestFrameDeltas.count());
+    for (auto it = bestFrameDeltas.constBegin(); it != bestFrameDeltas.constEnd(); ++it)
+    {
+        // A clip starting before the track gets negative differences from its first seconds
+        const auto frameDelta = qMax(0, it.value().second);
+        matches.append({it.key(), _trackPaths.at(static_cast<int>(it.key())), millisecondsFromFrames(frameDelta), it.value().first});
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const FingerprintMatch &a, const FingerprintMatch &b) {
+        return a.votes != b.votes ? a.votes > b.votes : a.trackId < b.trackId;
+    });
+
+    if (matches.count() > maxMatches)
+    {
+        matches.resize(qMax(0, maxMatches));
+    }
+
+    return matches;
+}
+
+void FingerprintIndex::vote(const Fingerprints &clipFingerprints, QHash<quint64, int> *votes) const
+{
+    const QReadLocker locker(&_lock);
+    addVotes(clipFingerprints, votes);
+}
+
+bool FingerprintIndex::isModified() const
+{
+    const QReadLocker locker(&_lock);
+    return _modified;
+}
+
+bool FingerprintIndex::save(const QString &filePath)
+{
+    const QWriteLocker locker(&_lock);
+
+    mergePendingPostings();
+
+    const auto tracks = trackTable(_trackPaths);
+    const auto header = fileHeader(_sampleRate, _hopSize, _trackPaths.count(), _postingsCount, tracks.size());
+
+    const qint64 bucketOffsetsSize = (BUCKETS_COUNT + 1) * sizeof(quint64);
+    const qint64 lowHashesSize = _postingsCount * sizeof(quint16);
+    const qint64 postingsSize = _postingsCount * sizeof(FingerprintPosting);
+    const QByteArray lowHashesPadding(static_cast<int>(header.postingsOffset - header.lowHashesOffset - lowHashesSize), '\0');
+
+    // The file appears at once or not at all, so the index is never loaded half written
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(Header)) != sizeof(Header)
+        || file.write(tracks) != tracks.size()
+        || file.write(reinterpret_cast<const char *>(_bucketOffsets), bucketOffsetsSize) != bucketOffsetsSize
+        || file.write(reinterpret_cast<const char *>(_lowHashes), lowHashesSize) != lowHashesSize
+        || file.write(lowHashesPadding) != lowHashesPadding.size()
+        || file.write(reinterpret_cast<const char *>(_postings), postingsSize) != postingsSize)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    _modified = false;
+
+    return true;
+}
+
+bool FingerprintIndex::merge(const QStringList &shardFilePaths, const QString &filePath)
+{
+    // Shards are only mapped, so they are merged in a single sequential pass over each section
+    // however large they are, and memory use stays at the write buffer and the track paths
+    QVector<QSharedPointer<FingerprintIndex>> shards;
+    QSet<QString> trackPathsSet;
+    QStringList trackPaths;
+    QVector<quint32> firstTrackIds;
+    qint64 postingsCount = 0;
+
+    for (const auto &shardFilePath : shardFilePaths)
+    {
+        const QSharedPointer<FingerprintIndex> shard(new FingerprintIndex());
+        if (!shard->load(shardFilePath))
+        {
+            return false;
+        }
+
+        if (!shards.isEmpty() && (shard->_sampleRate != shards.first()->_sampleRate || shard->_hopSize != shards.first()->_hopSize))
+        {
+            return false;
+        }
+
+        // A track in two shards would get two ids and split its votes
+        for (const auto &trackPath : shard->_trackPaths)
+        {
+            if (trackPathsSet.contains(trackPath))
+            {
+                return false;
+            }
+
+            trackPathsSet.insert(trackPath);
+        }
+
+        firstTrackIds.append(static_cast<quint32>(trackPaths.count()));
+        trackPaths.append(shard->_trackPaths);
+        postingsCount += shard->_postingsCount;
+        shards.append(shard);
+    }
+
+    if (shards.isEmpty())
+    {
+        return false;
+    }
+
+    const auto tracks = trackTable(trackPaths);
+    const auto header = fileHeader(shards.first()->_sampleRate, shards.first()->_hopSize, trackPaths.count(), postingsCount, tracks.size());
+
+    // Every bucket of the merged index holds the postings of the same bucket of all shards
+    QVector<quint64> bucketOffsets(BUCKETS_COUNT + 1, 0);
+    for (auto bucket = 0; bucket < BUCKETS_COUNT; bucket++)
+    {
+        quint64 bucketSize = 0;
+        for (const auto &shard : shards)
+        {
+            bucketSize += shard->_bucketOffsets[bucket + 1] - shard->_bucketOffsets[bucket];
+        }
+
+        bucketOffsets[bucket + 1] = bucketOffsets[bucket] + bucketSize;
+    }
+
+    const auto lowHashesSize = postingsCount * static_cast<qint64>(sizeof(quint16));
+    const QByteArray lowHashesPadding(static_cast<int>(header.postingsOffset - header.lowHashesOffset - lowHashesSize), '\0');
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(MERGE_BUFFER_SIZE);
+
+    auto written = true;
+    const auto flushBuffer = [&]() {
+        written = written && file.write(buffer) == buffer.size();
+        buffer.clear();
+    };
+    const auto append = [&](const void *data, const int size) {
+        buffer.append(static_cast<const char *>(data), size);
+        if (buffer.size() >= MERGE_BUFFER_SIZE)
+        {
+            flushBuffer();
+        }
+    };
+
+    append(&header, sizeof(Header));
+    append(tracks.constData(), tracks.size());
+    append(bucketOffsets.constData(), bucketOffsets.count() * static_cast<int>(sizeof(quint64)));
+
+    // The lower halves of the hashes and the postings are separate sections,
+    // so the shards are merged twice in the same order
+    forEachMergedPosting(shards, [&](const int shardIndex, const qint64 posting) {
+        append(shards[shardIndex]->_lowHashes + posting, sizeof(quint16));
+    });
+
+    append(lowHashesPadding.constData(), lowHashesPadding.size());
+
+    // Track ids of every shard follow the tracks of the shards before it.
+    // A damaged shard referring to tracks it does not have would make them refer to tracks of other shards
+    auto trackIdsValid = true;
+    forEachMergedPosting(shards, [&](const int shardIndex, const qint64 posting) {
+        auto mergedPosting = shards[shardIndex]->_postings[posting];
+        trackIdsValid = trackIdsValid && mergedPosting.trackId < static_cast<quint32>(shards[shardIndex]->_trackPaths.count());
+        mergedPosting.trackId += firstTrackIds[shardIndex];
+        append(&mergedPosting, sizeof(FingerprintPosting));
+    });
+
+    flushBuffer();
+
+    if (!written || !trackIdsValid)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool FingerprintIndex::load(const QString &filePath)
+{
+    const QWriteLocker locker(&_lock);
+
+    unmap();
+    clearPostings();
+    _trackPaths.clear();
+    _trackIds.clear();
+    _pendingPostings.clear();
+    _modified = false;
+
+    const auto fail = [this]() {
+        unmap();
+        clearPostings();
+        _trackPaths.clear();
+        _trackIds.clear();
+        return false;
+    };
+
+    _file.setFileName(filePath);
+    if (!_file.open(QIODevice::ReadOnly) || _file.size() < static_cast<qint64>(sizeof(Header)))
+    {
+        return fail();
+    }
+
+    _mappedData = _file.map(0, _file.size());
+    if (_mappedData == nullptr)
+    {
+        return fail();
+    }
+
+    const auto fileSize = static_cast<quint64>(_file.size());
+    const auto fileHeader = reinterpret_cast<const Header *>(_mappedData);
+    const auto postingsCount = fileHeader->postingsCount;
+
+    // Offsets and the postings count are bounded by the file size before any of them is added or multiplied,
+    // so a damaged header can not wrap the sizes around and pass the checks
+    if (fileHeader->magic != FINGERPRINT_INDEX_MAGIC
+        || fileHeader->version != VERSION
+        || fileHeader->bucketBits != BUCKET_BITS
+        || fileHeader->tracksOffset != sizeof(Header)
+        || fileHeader->bucketOffsetsOffset % 8 != 0
+        || fileHeader->bucketOffsetsOffset < fileHeader->tracksOffset
+        || fileHeader->bucketOffsetsOffset > fileSize
+        || fileHeader->lowHashesOffset != fileHeader->bucketOffsetsOffset + (BUCKETS_COUNT + 1) * sizeof(quint64)
+        || fileHeader->lowHashesOffset > fileSize
+        || postingsCount > (fileSize - fileHeader->lowHashesOffset) / (sizeof(quint16) + sizeof(FingerprintPosting))
+        || fileHeader->postingsOffset != static_cast<quint64>(alignedOffset(fileHeader->lowHashesOffset + postingsCount * sizeof(quint16)))
+        || fileSize != fileHeader->postingsOffset + postingsCount * sizeof(FingerprintPosting))
+    {
+        return fail();
+    }
+
+    auto trackOffset = fileHeader->tracksOffset;
+    for (quint32 trackId = 0; trackId < fileHeader->tracksCount; trackId++)
+    {
+        quint32 length;
+        if (trackOffset + sizeof(length) > fileHeader->bucketOffsetsOffset)
+        {
+            return fail();
+        }
+
+        memcpy(&length, _mappedData + trackOffset, sizeof(length));
+        trackOffset += sizeof(length);
+
+        if (trackOffset + length > fileHeader->bucketOffsetsOffset)
+        {
+            return fail();
+        }
+
+        const auto trackPath = QString::fromUtf8(reinterpret_cast<const char *>(_mappedData + trackOffset), static_cast<int>(length));
+        trackOffset += length;
+
+        _trackIds.insert(trackPath, trackId);
+        _trackPaths.append(trackPath);
+    }
+
+    // Buckets have to follow one another within the postings, or searches would read past them.
+    // Track ids of the postings are checked by the searches, which read only a few of them
+    const auto bucketOffsets = reinterpret_cast<const quint64 *>(_mappedData + fileHeader->bucketOffsetsOffset);
+    if (bucketOffsets[0] != 0 || bucketOffsets[BUCKETS_COUNT] != postingsCount)
+    {
+        return fail();
+    }
+
+    for (auto bucket = 0; bucket < BUCKETS_COUNT; bucket++)
+    {
+        if (bucketOffsets[bucket + 1] < bucketOffsets[bucket])
+        {
+            return fail();
+        }
+    }
+
+    _sampleRate = fileHeader->sampleRate;
+    _hopSize = static_cast<int>(fileHeader->hopSize);
+
+    _bucketOffsets = bucketOffsets;
+    _lowHashes = reinterpret_cast<const quint16 *>(_mappedData + fileHeader->lowHashesOffset);
+    _postings = reinterpret_cast<const FingerprintPosting *>(_mappedData + fileHeader->postingsOffset);
+    _postingsCount = static_cast<qint64>(postingsCount);
+
+    return true;
+}
+
+void FingerprintIndex::clear()
+{
+    const QWriteLocker locker(&_lock);
+
+    unmap();
+    clearPostings();
+    _trackPaths.clear();
+    _trackIds.clear();
+    _pendingPostings.clear();
+    _modified = false;
+}
+
+void FingerprintIndex::addVotes(const Fingerprints &clipFingerprints, QHash<quint64, int> *votes) const
+{
+    const auto tracksCount = static_cast<quint32>(_trackPaths.count());
+
+    const auto vote = [votes, tracksCount](const FingerprintPosting &posting, const quint32 clipFrame) {
+        // Postings of a damaged file may refer to tracks it does not have
+        if (posting.trackId >= tracksCount)
+        {
+            return;
+        }
+
+        const auto frameDelta = static_cast<qint32>(posting.frame - clipFrame);
+        (*votes)[static_cast<quint64>(posting.trackId) << 32 | static_cast<quint32>(frameDelta)]++;
+    };
+
+    for (const auto &fingerprint : clipFingerprints)
+    {
+        const auto bucket = fingerprint.hash >> BUCKET_BITS;
+        const auto lowHash = static_cast<quint16>(fingerprint.hash);
+
+        const auto bucketBegin = _lowHashes + _bucketOffsets[bucket];
+        const auto bucketEnd = _lowHashes + _bucketOffsets[bucket + 1];
+        const auto range = std::equal_range(bucketBegin, bucketEnd, lowHash);
+
+        for (auto lowHashIt = range.first; lowHashIt != range.second; ++lowHashIt)
+        {
+            vote(_postings[lowHashIt - _lowHashes], fingerprint.frame);
+        }
+    }
+
+    if (!_pendingPostings.empty())
+    {
+        QMultiHash<quint32, quint32> clipFrames;
+        for (const auto &fingerprint : clipFingerprints)
+        {
+            clipFrames.insert(fingerprint.hash, fingerprint.frame);
+        }
+
+        for (const auto &pendingPosting : _pendingPostings)
+        {
+            for (auto clipFrame = clipFrames.constFind(pendingPosting.hash);
+                 clipFrame != clipFrames.constEnd() && clipFrame.key() == pendingPosting.hash; ++clipFrame)
+            {
+                vote(pendingPosting.posting, clipFrame.value());
+            }
+        }
+    }
+}
+
+void FingerprintIndex::mergePendingPostings()
+{
+    if (_pendingPostings.empty())
+    {
+        return;
+    }
+
+    const auto pendingCount = static_cast<qint64>(_pendingPostings.size());
+    const auto mergedCount = _postingsCount + pendingCount;
+
+    std::stable_sort(_pendingPostings.begin(), _pendingPostings.end(), [](const PendingPosting &a, const PendingPosting &b) {
+        return a.hash < b.hash;
+    });
+
+    QVector<quint64> bucketOffsets(BUCKETS_COUNT + 1);
+    std::vector<quint16> lowHashes(static_cast<size_t>(mergedCount));
+    std::vector<FingerprintPosting> postings(static_cast<size_t>(mergedCount));
+
+    qint64 pendingIndex = 0;
+    qint64 mergedIndex = 0;
+
+    for (quint32 bucket = 0; bucket < static_cast<quint32>(BUCKETS_COUNT); bucket++)
+    {
+        bucketOffsets[bucket] = mergedIndex;
+
+        auto sortedIndex = static_cast<qint64>(_bucketOffsets[bucket]);
+        const auto sortedEnd = static_cast<qint64>(_bucketOffsets[bucket + 1]);
+
+        while (true)
+        {
+            const auto pendingLeft = pendingIndex < pendingCount && _pendingPostings[pendingIndex].hash >> BUCKET_BITS == bucket;
+            const auto sortedLeft = sortedIndex < sortedEnd;
+
+            if (!pendingLeft && !sortedLeft)
+            {
+                break;
+            }
+
+            // Postings with equal hashes keep their insertion order, the sorted ones being inserted earlier
+            if (pendingLeft && (!sortedLeft || static_cast<quint16>(_pendingPostings[pendingIndex].hash) < _lowHashes[sortedIndex]))
+            {
+                lowHashes[mergedIndex] = static_cast<quint16>(_pendingPostings[pendingIndex].hash);
+                postings[mergedIndex] = _pendingPostings[pendingIndex].posting;
+                pendingIndex++;
+            }
+            else
+            {
+                lowHashes[mergedIndex] = _lowHashes[sortedIndex];
+                postings[mergedIndex] = _postings[sortedIndex];
+                sortedIndex++;
+            }
+
+            mergedIndex++;
+        }
+    }
+
+    bucketOffsets[BUCKETS_COUNT] = mergedIndex;
+
+    // The mapped file is not needed anymore, since every sorted posting was copied
+    unmap();
+
+    _ownedBucketOffsets = std::move(bucketOffsets);
+    _ownedLowHashes = std::move(lowHashes);
+    _ownedPostings = std::move(postings);
+
+    _bucketOffsets = _ownedBucketOffsets.constData();
+    _lowHashes = _ownedLowHashes.data();
+    _postings = _ownedPostings.data();
+    _postingsCount = mergedCount;
+
+    _pendingPostings.clear();
+    _pendingPostings.shrink_to_fit();
+}
+
+QByteArray FingerprintIndex::trackTable(const QStringList &trackPaths)
+{
+    QByteArray tracks;
+    for (const auto &trackPath : trackPaths)
+    {
+        const auto utf8Path = trackPath.toUtf8();
+        const auto length = static_cast<quint32>(utf8Path.size());
+
+        tracks.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        tracks.append(utf8Path);
+    }
+    tracks.append(static_cast<int>(alignedOffset(tracks.size()) - tracks.size()), '\0');
+
+    return tracks;
+}
+
+FingerprintIndex::Header FingerprintIndex::fileHeader(
+    const quint32 sampleRate,
+    const int hopSize,
+    const int tracksCount,
+    const qint64 postingsCount,
+    const int trackTableSize)
+{
+    Header header{};
+    header.magic = FINGERPRINT_INDEX_MAGIC;
+    header.version = VERSION;
+    header.bucketBits = BUCKET_BITS;
+    header.sampleRate = sampleRate;
+    header.hopSize = static_cast<quint32>(hopSize);
+    header.tracksCount = static_cast<quint32>(tracksCount);
+    header.postingsCount = static_cast<quint64>(postingsCount);
+    header.tracksOffset = sizeof(Header);
+    header.bucketOffsetsOffset = header.tracksOffset + trackTableSize;
+    header.lowHashesOffset = header.bucketOffsetsOffset + (BUCKETS_COUNT + 1) * sizeof(quint64);
+    header.postingsOffset = alignedOffset(header.lowHashesOffset + postingsCount * sizeof(quint16));
+
+    return header;
+}
+
+void FingerprintIndex::forEachMergedPosting(
+    const QVector<QSharedPointer<FingerprintIndex>> &shards,
+    const std::function<void(int, qint64)> &visit)
+{
+    QVector<qint64> positions(shards.count());
+
+    for (auto bucket = 0; bucket < BUCKETS_COUNT; bucket++)
+    {
+        for (auto shardIndex = 0; shardIndex < shards.count(); shardIndex++)
+        {
+            positions[shardIndex] = static_cast<qint64>(shards[shardIndex]->_bucketOffsets[bucket]);
+        }
+
+        // Buckets hold a few postings each, so the shards are compared directly instead of through a heap.
+        // Equal hashes are taken from the earlier shard first, as if its tracks were inserted earlier
+        while (true)
+        {
+            auto nextShardIndex = -1;
+            for (auto shardIndex = 0; shardIndex < shards.count(); shardIndex++)
+            {
+                const auto &shard = *shards[shardIndex];
+                if (positions[shardIndex] < static_cast<qint64>(shard._bucketOffsets[bucket + 1])
+                    && (nextShardIndex < 0
+                        || shard._lowHashes[positions[shardIndex]] < shards[nextShardIndex]->_lowHashes[positions[nextShardIndex]]))
+                {
+                    nextShardIndex = shardIndex;
+                }
+            }
+
+            if (nextShardIndex < 0)
+            {
+                break;
+            }
+
+            visit(nextShardIndex, positions[nextShardIndex]++);
+        }
+    }
+}
+
+void FingerprintIndex::clearPostings()
+{
+    _ownedBucketOffsets = QVector<quint64>(BUCKETS_COUNT + 1, 0);
+    _ownedLowHashes.clear();
+    _ownedPostings.clear();
+
+    _bucketOffsets = _ownedBucketOffsets.constData();
+    _lowHashes = _ownedLowHashes.data();
+    _postings = _ownedPostings.data();
+    _postingsCount = 0;
+}
+
+void FingerprintIndex::unmap()
+{
+    if (_mappedData != nullptr)
+    {
+        _file.unmap(_mappedData);
+        _mappedData = nullptr;
+    }
+
+    _file.close();
+}
+
+qint64 FingerprintIndex::millisecondsFromFrames(const qint64 frames) const
+{
+    if (_sampleRate == 0)
+    {
+        return 0;
+    }
+
+    return frames * _hopSize * 1000 / _sampleRate;
+}
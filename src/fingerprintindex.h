@@ -0,0 +1,151 @@
+#pragma once
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <vector>
+#include "fingerprint.h"
+
+// Occurrence of a fingerprint hash in an indexed track
+struct FingerprintPosting
+{
+    quint32 trackId;
+    quint32 frame;
+};
+Q_DECLARE_TYPEINFO(FingerprintPosting, Q_PRIMITIVE_TYPE);
+
+struct FingerprintMatch
+{
+    quint32 trackId;
+    QString trackPath;
+    // Position in the track where the searched clip starts
+    qint64 offsetMs;
+    // Fingerprints of the clip found in the track at the same relative time
+    int votes;
+};
+Q_DECLARE_METATYPE(FingerprintMatch)
+
+// Inverted index from fingerprint hashes to their postings in the indexed tracks.
+// Postings are kept in a single array sorted by hash and split into buckets by the upper 16 bits of the hash,
+// while only the lower 16 bits are stored beside them and binary searched within a bucket.
+// Fingerprint hashes are spread evenly over all their bits, so the buckets fill evenly.
+// Inserted tracks wait in an unsorted pending array, which is searched by a linear scan until build()
+// merges it in, so many tracks are indexed at the cost of a single merge.
+// Postings are counted in 64 bits, so an index of any size fits as long as the memory does.
+// Saved indexes are loaded through a memory mapping and searched straight from the page cache.
+// All methods may be called from several threads at once.
+class FingerprintIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const quint16 VERSION;
+
+    explicit FingerprintIndex(QObject *parent = nullptr);
+    ~FingerprintIndex();
+
+    // Index file of the application, used when no other one is given
+    static QString defaultFilePath();
+
+    // Frames of the fingerprints start every hopSize samples of audio sampled at sampleRate
+    quint32 sampleRate() const;
+    int hopSize() const;
+    void setFraming(quint32 sampleRate, int hopSize);
+
+    int tracksCount() const;
+    qint64 postingsCount() const;
+    bool contains(const QString &trackPath) const;
+    QString trackPath(quint32 trackId) const;
+
+    // Adds the fingerprints of a track that is not in the index yet and returns the id of the track
+    quint32 insert(const QString &trackPath, const Fingerprints &fingerprints);
+
+    // Merges the pending postings into the sorted ones
+    void build();
+
+    // Merges the pending postings once they grow to a fraction of the sorted ones. Merging copies
+    // the whole index, so indexes built up by many small insertions cost a constant time per posting
+    void buildIfNeeded();
+
+    // Tracks whose fingerprints line up with the most fingerprints of the clip, the best one first.
+    // Every fingerprint found votes for a track and the difference between its frames in the track and the clip
+    QVector<FingerprintMatch> search(const Fingerprints &clipFingerprints, int maxMatches = 1) const;
+
+    // Adds the votes of the clip fingerprints to the ones counted before, by the track and the frame difference
+    // packed into the upper and lower halves of the key, so a growing clip is searched a piece at a time
+    void vote(const Fingerprints &clipFingerprints, QHash<quint64, int> *votes) const;
+
+    // True if tracks were inserted since the index was loaded or saved
+    bool isModified() const;
+
+    // Builds the index and writes it to the file
+    bool save(const QString &filePath);
+
+    // Maps the file saved before. Returns false and leaves the index empty if it is missing or damaged
+    bool load(const QString &filePath);
+
+    // Writes the index of all tracks of the shard files, e.g. built by separate processes or machines.
+    // Shards are merged straight from their mappings, so they never have to fit into memory together.
+    // Returns false if a shard cannot be loaded, the shards were framed differently or share a track
+    static bool merge(const QStringList &shardFilePaths, const QString &filePath);
+
+    // Empties the index. Unlike insertions, this does not mark it modified
+    void clear();
+
+private:
+    struct Header;
+
+    struct PendingPosting
+    {
+        quint32 hash;
+        FingerprintPosting posting;
+    };
+
+    static const int BUCKET_BITS = 16;
+    static const int BUCKETS_COUNT = 1 << BUCKET_BITS;
+    // Merged sections are written in pieces of this size
+    static const int MERGE_BUFFER_SIZE = 1 << 20;
+    // buildIfNeeded() merges once the pending postings reach this part of the sorted ones
+    static const int PENDING_POSTINGS_DIVISOR = 8;
+
+    mutable QReadWriteLock _lock;
+
+    quint32 _sampleRate = 0;
+    int _hopSize = 0;
+    QStringList _trackPaths;
+    QHash<QString, quint32> _trackIds;
+
+    // Sorted postings point either to the vectors below or into the mapped index file
+    const quint64 *_bucketOffsets = nullptr;
+    const quint16 *_lowHashes = nullptr;
+    const FingerprintPosting *_postings = nullptr;
+    qint64 _postingsCount = 0;
+
+    // QVector is limited to 2^31 values, which large libraries exceed
+    QVector<quint64> _ownedBucketOffsets;
+    std::vector<quint16> _ownedLowHashes;
+    std::vector<FingerprintPosting> _ownedPostings;
+
+    QFile _file;
+    uchar *_mappedData = nullptr;
+
+    std::vector<PendingPosting> _pendingPostings;
+    bool _modified = false;
+
+    static QByteArray trackTable(const QStringList &trackPaths);
+    static Header fileHeader(quint32 sampleRate, int hopSize, int tracksCount, qint64 postingsCount, int trackTableSize);
+    // Visits the sorted postings of all shards in the order of the merged index, by the shard and the posting
+    static void forEachMergedPosting(const QVector<QSharedPointer<FingerprintIndex>> &shards,
+                                     const std::function<void(int, qint64)> &visit);
+
+    void addVotes(const Fingerprints &clipFingerprints, QHash<quint64, int> *votes) const;
+    void mergePendingPostings();
+    void clearPostings();
+    void unmap();
+    qint64 millisecondsFromFrames(qint64 frames) const;
+};
@@ -0,0 +1,357 @@
+#include "headlessmode.h"
+
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QThread>
+
+const QStringList HeadlessMode::MEDIA_FILE_FILTERS = QStringList()
+    << "*.mp3" << "*.flac" << "*.wav" << "*.ogg" << "*.opus" << "*.m4a" << "*.aac" << "*.wma"
+    << "*.mp4" << "*.mkv" << "*.avi" << "*.mov" << "*.webm";
+
+HeadlessMode::HeadlessMode(QObject *parent)
+    : QObject(parent),
+      _output(stdout),
+      _errorOutput(stderr)
+{
+    _audioSearchEngine = new AudioSearchEngine(this);
+}
+
+HeadlessMode::~HeadlessMode()
+{
+}
+
+bool HeadlessMode::isRequested(const int argc, char *argv[])
+{
+    for (auto i = 1; i < argc; i++)
+    {
+        const auto argument = QString::fromLocal8Bit(argv[i]);
+
+        if (argument == "--index" || argument == "--search" || argument == "--merge"
+            || argument.startsWith("--index=") || argument.startsWith("--search=") || argument.startsWith("--merge="))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int HeadlessMode::run(const QCoreApplication &application)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Audio library indexing and search");
+    parser.addHelpOption();
+
+    const QCommandLineOption indexOption("index", "Adds the media files of the directory and its subdirectories to the index.", "directory");
+    const QCommandLineOption searchOption("search", "Searches the index for the track the clip comes from.", "clip");
+    const QCommandLineOption mergeOption("merge", "Merges the shard files given as arguments into the file.", "file");
+    const QCommandLineOption indexFileOption("index-file", "The index file. Searches every one given.", "file", FingerprintIndex::defaultFilePath());
+    const QCommandLineOption jobsOption("jobs", "Files analyzed in parallel while indexing.", "count",
+                                       QString::number(QThread::idealThreadCount()));
+    const QCommandLineOption shardOption("shard", "Indexes only the files of the shard, counted from 0.", "index/count", "0/1");
+    const QCommandLineOption traceOption("trace", "Writes the stages of every analysis as a Chrome trace.", "file");
+
+    parser.addOption(indexOption);
+    parser.addOption(searchOption);
+    parser.addOption(mergeOption);
+    parser.addOption(indexFileOption);
+    parser.addOption(jobsOption);
+    parser.addOption(shardOption);
+    parser.addOption(traceOption);
+    parser.addPositionalArgument("shards", "Shard files to merge.", "[shard files...]");
+    parser.process(application);
+
+    if (parser.isSet(mergeOption))
+    {
+        return merge(parser.value(mergeOption), parser.positionalArguments());
+    }
+
+    const auto indexFilePaths = parser.values(indexFileOption);
+    const auto indexLoaded = _audioSearchEngine->loadFingerprintIndex(indexFilePaths.first());
+
+    if (parser.isSet(indexOption))
+    {
+        if (!indexLoaded && _audioSearchEngine->fingerprintIndexFilePath().isEmpty())
+        {
+            _errorOutput << "Can not read the index at " << indexFilePaths.first()
+                         << ", it is damaged or was written by another version" << endl;
+            return 1;
+        }
+
+        auto shardIndex = 0;
+        auto shardsCount = 1;
+        if (!parseShard(parser.value(shardOption), &shardIndex, &shardsCount))
+        {
+            _errorOutput << "Invalid shard " << parser.value(shardOption) << endl;
+            return 1;
+        }
+
+        return index(parser.value(indexOption), qMax(1, parser.value(jobsOption).toInt()), shardIndex, shardsCount,
+                     parser.value(traceOption));
+    }
+
+    if (!indexLoaded)
+    {
+        _errorOutput << "No index at " << indexFilePaths.first() << endl;
+        return 1;
+    }
+
+    for (auto i = 1; i < indexFilePaths.count(); i++)
+    {
+        if (!_audioSearchEngine->addSearchedFingerprintIndex(indexFilePaths[i]))
+        {
+            _errorOutput << "No index at " << indexFilePaths[i] << endl;
+            return 1;
+        }
+    }
+
+    return search(parser.value(searchOption));
+}
+
+int HeadlessMode::index(
+    const QString &directoryPath,
+    const int jobsCount,
+    const int shardIndex,
+    const int shardsCount,
+    const QString &traceFilePath)
+{
+    const auto fingerprintIndex = _audioSearchEngine->fingerprintIndex();
+
+    // Shards are chosen by the paths within the library, which may be mounted elsewhere on every machine
+    const QDir directory(directoryPath);
+
+    QStringList filePaths;
+    auto indexedFilesCount = 0;
+    for (const auto &filePath : findMediaFiles(directoryPath))
+    {
+        if (!isInShard(directory.relativeFilePath(filePath), shardIndex, shardsCount))
+        {
+            continue;
+        }
+
+        if (fingerprintIndex->contains(filePath))
+        {
+            indexedFilesCount++;
+        }
+        else
+        {
+            filePaths.append(filePath);
+        }
+    }
+
+    _output << "Indexing " << filePaths.count() << " files, " << indexedFilesCount << " already indexed" << endl;
+
+    // Whole files are analyzed in parallel, which keeps every core busy without splitting spectrograms
+    _audioSearchEngine->setAnalysisCacheEnabled(false);
+    _audioSearchEngine->setMaxConcurrentAnalyses(jobsCount);
+    _audioSearchEngine->setSpectrumWorkerCount(1);
+    _audioSearchEngine->setPipelineTracingEnabled(!traceFilePath.isEmpty());
+
+    auto finishedCount = 0;
+    auto failedCount = 0;
+    qint64 audioDurationMs = 0;
+
+    QEventLoop eventLoop;
+    const auto quitWhenDone = [&]() {
+        if (finishedCount + failedCount == filePaths.count())
+        {
+            eventLoop.quit();
+        }
+    };
+
+    connect(_audioSearchEngine, &AudioSearchEngine::analysisFinished, &eventLoop, [&](const QString &, const qint64 durationMs) {
+        finishedCount++;
+        audioDurationMs += durationMs;
+        quitWhenDone();
+    });
+    connect(_audioSearchEngine, &AudioSearchEngine::analysisFailed, &eventLoop, [&](const QString &filePath, const QString &errorMessage) {
+        failedCount++;
+        _errorOutput << filePath << ": " << errorMessage << endl;
+        quitWhenDone();
+    });
+
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+
+    for (const auto &filePath : filePaths)
+    {
+        _audioSearchEngine->analyze(filePath);
+    }
+
+    if (!filePaths.isEmpty())
+    {
+        eventLoop.exec();
+    }
+
+    if (!_audioSearchEngine->saveFingerprintIndex())
+    {
+        _errorOutput << "Error writing the index to " << _audioSearchEngine->fingerprintIndexFilePath() << endl;
+        return 1;
+    }
+
+    const auto elapsedSeconds = qMax(elapsedTimer.elapsed(), static_cast<qint64>(1)) / 1000.0;
+    const auto audioHours = audioDurationMs / 3600000.0;
+
+    _output << "Indexed " << finishedCount << " files (" << failedCount << " failed) in " << elapsedSeconds << " s: "
+            << finishedCount / elapsedSeconds << " files/s, " << audioHours / elapsedSeconds << " audio hours/s" << endl;
+    _output << "Index: " << fingerprintIndex->tracksCount() << " tracks, " << fingerprintIndex->postingsCount()
+            << " fingerprints" << endl;
+
+    const auto pipelineStats = _audioSearchEngine->pipelineStats();
+    printPipelineStats(pipelineStats, elapsedSeconds);
+
+    if (!traceFilePath.isEmpty() && !pipelineStats.writeChromeTrace(traceFilePath))
+    {
+        _errorOutput << "Error writing the trace to " << traceFilePath << endl;
+    }
+
+    return failedCount == 0 ? 0 : 1;
+}
+
+int HeadlessMode::merge(const QString &filePath, const QStringList &shardFilePaths)
+{
+    if (shardFilePaths.isEmpty())
+    {
+        _errorOutput << "No shard files to merge" << endl;
+        return 1;
+    }
+
+    QElapsedTimer elapsedTimer;
+    elapsedTimer.start();
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    if (!FingerprintIndex::merge(shardFilePaths, filePath))
+    {
+        _errorOutput << "Error merging the shards into " << filePath
+                     << ", every shard has to be a valid index of other tracks analyzed the same way" << endl;
+        return 1;
+    }
+
+    FingerprintIndex mergedIndex;
+    mergedIndex.load(filePath);
+
+    _output << "Merged " << shardFilePaths.count() << " shards in " << elapsedTimer.elapsed() / 1000.0 << " s: "
+            << mergedIndex.tracksCount() << " tracks, " << mergedIndex.postingsCount() << " fingerprints" << endl;
+
+    return 0;
+}
+
+int HeadlessMode::search(const QString &clipFilePath)
+{
+    FingerprintMatch bestMatch{};
+    auto found = false;
+
+    QEventLoop eventLoop;
+
+    connect(_audioSearchEngine, &AudioSearchEngine::searchMatchFound, &eventLoop,
+            [&](const FingerprintMatch &match, const double confidence, const qint64 latencyMs) {
+        _output << "First match after " << latencyMs << " ms: " << match.trackPath << " at " << match.offsetMs
+                << " ms, confidence " << confidence << endl;
+    });
+    connect(_audioSearchEngine, &AudioSearchEngine::searchFinished, &eventLoop, [&](const FingerprintMatch &match) {
+        bestMatch = match;
+        found = !match.trackPath.isEmpty();
+        eventLoop.quit();
+    });
+    connect(_audioSearchEngine, &AudioSearchEngine::error, &eventLoop, [&](const QString &errorMessage) {
+        _errorOutput << errorMessage << endl;
+        eventLoop.quit();
+    });
+
+    _audioSearchEngine->search(clipFilePath);
+    eventLoop.exec();
+
+    if (!found)
+    {
+        _output << "No match found" << endl;
+        return 1;
+    }
+
+    _output << "Best match: " << bestMatch.trackPath << " at " << bestMatch.offsetMs << " ms, "
+            << bestMatch.votes << " aligned fingerprints" << endl;
+
+    return 0;
+}
+
+void HeadlessMode::printPipelineStats(const PipelineStats &stats, const double elapsedSeconds)
+{
+    // Stages of files analyzed in parallel add up, so their share is of the time of all jobs together
+    qint64 totalWallTimeNs = 0;
+    for (auto stage = 0; stage < PipelineStats::StagesCount; stage++)
+    {
+        totalWallTimeNs += stats.stage(static_cast<PipelineStats::Stage>(stage)).wallTimeNs;
+    }
+
+    _output << "Stages (" << elapsedSeconds << " s elapsed):" << endl;
+
+    for (auto stage = 0; stage < PipelineStats::StagesCount; stage++)
+    {
+        const auto &stageStats = stats.stage(static_cast<PipelineStats::Stage>(stage));
+        if (stageStats.calls == 0)
+        {
+            continue;
+        }
+
+        const auto wallTimeS = stageStats.wallTimeNs / 1e9;
+        _output << "  " << PipelineStats::stageName(static_cast<PipelineStats::Stage>(stage)) << ": "
+                << wallTimeS << " s (" << 100.0 * stageStats.wallTimeNs / qMax(totalWallTimeNs, static_cast<qint64>(1)) << " %), "
+                << stageStats.calls << " calls, "
+                << stageStats.bytes / 1048576.0 << " MiB, "
+                << stageStats.frames << " frames";
+
+        if (PipelineStats::countsAllocations())
+        {
+            _output << ", " << stageStats.allocations << " allocations";
+        }
+
+        _output << endl;
+    }
+}
+
+QStringList HeadlessMode::findMediaFiles(const QString &directoryPath)
+{
+    QStringList filePaths;
+
+    QDirIterator it(directoryPath, MEDIA_FILE_FILTERS, QDir::Files | QDir::Readable, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+    while (it.hasNext())
+    {
+        filePaths.append(QFileInfo(it.next()).absoluteFilePath());
+    }
+
+    // Analyses start in the same order in every run, whatever order the file system lists files in.
+    // Tracks enter the index as their analyses finish, so their ids still vary between runs
+    filePaths.sort();
+
+    return filePaths;
+}
+
+bool HeadlessMode::parseShard(const QString &shard, int *shardIndex, int *shardsCount)
+{
+    const auto parts = shard.split('/');
+    if (parts.count() != 2)
+    {
+        return false;
+    }
+
+    auto indexValid = false;
+    auto countValid = false;
+    *shardIndex = parts[0].toInt(&indexValid);
+    *shardsCount = parts[1].toInt(&countValid);
+
+    return indexValid && countValid && *shardsCount > 0 && *shardIndex >= 0 && *shardIndex < *shardsCount;
+}
+
+bool HeadlessMode::isInShard(const QString &relativeFilePath, const int shardIndex, const int shardsCount)
+{
+    // Hashed rather than dealt out in turn, so adding a file to the library does not move the others
+    const auto hash = QCryptographicHash::hash(relativeFilePath.toUtf8(), QCryptographicHash::Sha1);
+
+    quint32 value;
+    memcpy(&value, hash.constData(), sizeof(value));
+
+    return static_cast<int>(value % static_cast<quint32>(shardsCount)) == shardIndex;
+}
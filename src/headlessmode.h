@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QObject>
+#include <QCoreApplication>
+#include <QTextStream>
+#include "audiosearchengine.h"
+
+// Indexing and searching from the command line, for servers without a display:
+//   VSPlayer --index <directory> [--index-file <file>] [--jobs <count>] [--shard <index>/<count>] [--trace <file>]
+//   VSPlayer --merge <file> <shard file>...
+//   VSPlayer --search <clip> [--index-file <file>]...
+// Libraries too large for one process are indexed into shards, e.g. one per machine with the same
+// --shard count, which are merged into one index or searched together by giving every shard file.
+// Runs on a QCoreApplication and never creates any widgets.
+class HeadlessMode : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessMode(QObject *parent = nullptr);
+    ~HeadlessMode();
+
+    // Checked before any application object exists, since a QApplication needs a display
+    static bool isRequested(int argc, char *argv[]);
+
+    // Runs the command given by the application arguments and returns the exit code
+    int run(const QCoreApplication &application);
+
+private:
+    static const QStringList MEDIA_FILE_FILTERS;
+
+    AudioSearchEngine *_audioSearchEngine = nullptr;
+    QTextStream _output;
+    QTextStream _errorOutput;
+
+    int index(const QString &directoryPath, int jobsCount, int shardIndex, int shardsCount, const QString &traceFilePath);
+    int merge(const QString &filePath, const QStringList &shardFilePaths);
+    int search(const QString &clipFilePath);
+
+    void printPipelineStats(const PipelineStats &stats, double elapsedSeconds);
+
+    static QStringList findMediaFiles(const QString &directoryPath);
+
+    // Parses "<index>/<count>". Returns false if it is malformed
+    static bool parseShard(const QString &shard, int *shardIndex, int *shardsCount);
+    // Every file belongs to the same shard on every machine indexing the same library
+    static bool isInShard(const QString &relativeFilePath, int shardIndex, int shardsCount);
+};
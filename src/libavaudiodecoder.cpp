@@ -0,0 +1,210 @@
+#include "libavaudiodecoder.h"
+
+#ifdef VSPLAYER_WITH_LIBAV
+
+#include "audiodecoderexception.h"
+
+#include <QFile>
+#include <QScopedPointer>
+#include <climits>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+// AVChannelLayout replaced the channel mask and count in FFmpeg 5.1
+#define LIBAV_HAS_CHANNEL_LAYOUT (LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 28, 100))
+
+namespace
+{
+    // libav releases its objects through pointers to pointers, which QScopedPointer cleanups adapt
+    struct FormatContextCleanup
+    {
+        static void cleanup(AVFormatContext *formatContext) { avformat_close_input(&formatContext); }
+    };
+
+    struct CodecContextCleanup
+    {
+        static void cleanup(AVCodecContext *codecContext) { avcodec_free_context(&codecContext); }
+    };
+
+    struct ResamplerCleanup
+    {
+        static void cleanup(SwrContext *resampler) { swr_free(&resampler); }
+    };
+
+    struct PacketCleanup
+    {
+        static void cleanup(AVPacket *packet) { av_packet_free(&packet); }
+    };
+
+    struct FrameCleanup
+    {
+        static void cleanup(AVFrame *frame) { av_frame_free(&frame); }
+    };
+}
+
+LibavAudioDecoder::LibavAudioDecoder(const int sampleRate, const int channelsCount)
+    : _sampleRate(sampleRate),
+      _channelsCount(channelsCount)
+{
+}
+
+QByteArray LibavAudioDecoder::decode(const QString &filePath) const
+{
+    QByteArray pcmAudioData;
+    decode(filePath, &pcmAudioData, nullptr);
+
+    return pcmAudioData;
+}
+
+void LibavAudioDecoder::decode(const QString &filePath, const std::function<void(const qint16 *, int)> &consumeFrames) const
+{
+    const auto bytesPerFrame = _channelsCount * static_cast<int>(sizeof(qint16));
+
+    // The block keeps its capacity, so it is allocated once for the largest decoded frame
+    QByteArray block;
+    decode(filePath, &block, [&](QByteArray *pcmAudioData) {
+        const auto framesCount = pcmAudioData->size() / bytesPerFrame;
+        if (framesCount > 0)
+        {
+            consumeFrames(reinterpret_cast<const qint16 *>(pcmAudioData->constData()), framesCount);
+        }
+
+        pcmAudioData->resize(0);
+    });
+}
+
+void LibavAudioDecoder::decode(
+    const QString &filePath,
+    QByteArray *pcmAudioData,
+    const std::function<void(QByteArray *)> &consumeDecoded) const
+{
+    AVFormatContext *openedFormatContext = nullptr;
+    if (avformat_open_input(&openedFormatContext, QFile::encodeName(filePath).constData(), nullptr, nullptr) < 0)
+    {
+        throw AudioDecoderException("Error opening media file");
+    }
+
+    const QScopedPointer<AVFormatContext, FormatContextCleanup> formatContext(openedFormatContext);
+
+    if (avformat_find_stream_info(formatContext.data(), nullptr) < 0)
+    {
+        throw AudioDecoderException("Error reading media file streams");
+    }
+
+    const auto streamIndex = av_find_best_stream(formatContext.data(), AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (streamIndex < 0)
+    {
+        throw AudioDecoderException("Media file has no audio stream");
+    }
+
+    const auto stream = formatContext->streams[streamIndex];
+    const auto codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (codec == nullptr)
+    {
+        throw AudioDecoderException("Unsupported audio codec");
+    }
+
+    const QScopedPointer<AVCodecContext, CodecContextCleanup> codecContext(avcodec_alloc_context3(codec));
+    if (codecContext.isNull()
+        || avcodec_parameters_to_context(codecContext.data(), stream->codecpar) < 0
+        || avcodec_open2(codecContext.data(), codec, nullptr) < 0)
+    {
+        throw AudioDecoderException("Error opening audio decoder");
+    }
+
+    SwrContext *allocatedResampler = nullptr;
+
+#if LIBAV_HAS_CHANNEL_LAYOUT
+    AVChannelLayout outputChannelLayout;
+    av_channel_layout_default(&outputChannelLayout, _channelsCount);
+
+    swr_alloc_set_opts2(&allocatedResampler,
+                        &outputChannelLayout, AV_SAMPLE_FMT_S16, _sampleRate,
+                        &codecContext->ch_layout, codecContext->sample_fmt, codecContext->sample_rate,
+                        0, nullptr);
+#else
+    // Some containers leave the layout unset and only report the number of channels
+    const auto inputChannelLayout = codecContext->channel_layout != 0
+        ? codecContext->channel_layout
+        : av_get_default_channel_layout(codecContext->channels);
+
+    allocatedResampler = swr_alloc_set_opts(nullptr,
+                                            av_get_default_channel_layout(_channelsCount), AV_SAMPLE_FMT_S16, _sampleRate,
+                                            inputChannelLayout, codecContext->sample_fmt, codecContext->sample_rate,
+                                            0, nullptr);
+#endif
+
+    const QScopedPointer<SwrContext, ResamplerCleanup> resampler(allocatedResampler);
+    if (resampler.isNull() || swr_init(resampler.data()) < 0)
+    {
+        throw AudioDecoderException("Error initializing audio resampler");
+    }
+
+    const auto bytesPerFrame = _channelsCount * static_cast<int>(sizeof(qint16));
+
+    // The container duration, if known, saves reallocations of the whole track
+    if (!consumeDecoded && formatContext->duration > 0)
+    {
+        const auto expectedBytes = av_rescale(formatContext->duration, _sampleRate, AV_TIME_BASE) * bytesPerFrame;
+        pcmAudioData->reserve(static_cast<int>(qMin<qint64>(expectedBytes, INT_MAX / 2)));
+    }
+
+    const auto appendResampled = [&](const quint8 **input, const int inputSamples) {
+        const auto outputSamples = swr_get_out_samples(resampler.data(), inputSamples);
+        if (outputSamples <= 0)
+        {
+            return;
+        }
+
+        const auto offset = pcmAudioData->size();
+        pcmAudioData->resize(offset + outputSamples * bytesPerFrame);
+
+        auto output = reinterpret_cast<quint8 *>(pcmAudioData->data() + offset);
+        const auto convertedSamples = swr_convert(resampler.data(), &output, outputSamples, input, inputSamples);
+        if (convertedSamples < 0)
+        {
+            throw AudioDecoderException("Error resampling audio");
+        }
+
+        pcmAudioData->resize(offset + convertedSamples * bytesPerFrame);
+
+        if (consumeDecoded)
+        {
+            consumeDecoded(pcmAudioData);
+        }
+    };
+
+    const QScopedPointer<AVPacket, PacketCleanup> packet(av_packet_alloc());
+    const QScopedPointer<AVFrame, FrameCleanup> frame(av_frame_alloc());
+
+    const auto receiveFrames = [&]() {
+        while (avcodec_receive_frame(codecContext.data(), frame.data()) == 0)
+        {
+            appendResampled(const_cast<const quint8 **>(frame->extended_data), frame->nb_samples);
+            av_frame_unref(frame.data());
+        }
+    };
+
+    while (av_read_frame(formatContext.data(), packet.data()) >= 0)
+    {
+        // Damaged packets are skipped like ffmpeg does rather than failing the whole track
+        if (packet->stream_index == streamIndex && avcodec_send_packet(codecContext.data(), packet.data()) == 0)
+        {
+            receiveFrames();
+        }
+
+        av_packet_unref(packet.data());
+    }
+
+    // Drains the frames buffered by the decoder and the samples buffered by the resampler
+    avcodec_send_packet(codecContext.data(), nullptr);
+    receiveFrames();
+    appendResampled(nullptr, 0);
+}
+
+#endif
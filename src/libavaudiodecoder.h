@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+// Decodes the audio stream of a media file straight into memory with libavformat and libavcodec
+// and resamples it with libswresample to interleaved signed 16-bit little-endian PCM.
+// Available in builds with VSPLAYER_WITH_LIBAV defined, which qmake sets when it finds the FFmpeg libraries.
+class LibavAudioDecoder final
+{
+public:
+    LibavAudioDecoder(int sampleRate, int channelsCount);
+
+    QByteArray decode(const QString &filePath) const;
+
+    // Passes the decoded audio to the consumer a block of whole frames at a time as it is decoded,
+    // so the track is never kept in memory as a whole
+    void decode(const QString &filePath, const std::function<void(const qint16 *, int)> &consumeFrames) const;
+
+private:
+    int _sampleRate;
+    int _channelsCount;
+
+    // Appends the decoded audio to pcmAudioData. If consumeDecoded is set, it is called after every
+    // decoded frame and may empty the buffer, otherwise the buffer is reserved for the whole track
+    void decode(const QString &filePath, QByteArray *pcmAudioData,
+                const std::function<void(QByteArray *)> &consumeDecoded) const;
+};
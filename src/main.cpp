@@ -1,6 +1,7 @@
 #include "app.h"
 #include "player.h"
 #include "audiosearchengine.h"
+#include "headlessmode.h"
 
 #include <QCommandLineParser>
 #include <QCommandLineOption>
@@ -8,11 +9,20 @@
 
 int main(int argc, char *argv[])
 {
-    App app(argc, argv);
-
+    // Set before any application object, so both modes share the default index and cache locations
     QCoreApplication::setApplicationName("Player Example");
     QCoreApplication::setOrganizationName("QtProject");
     QCoreApplication::setApplicationVersion(QT_VERSION_STR);
+
+    // Headless servers have no display for a QApplication
+    if (HeadlessMode::isRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        HeadlessMode headlessMode;
+        return headlessMode.run(app);
+    }
+
+    App app(argc, argv);
+
     QCommandLineParser parser;
     QCommandLineOption customAudioRoleOption("custom-audio-role",
                                              "Set a custom audio role for the player.",
@@ -9,9 +9,15 @@ PcmAudioData::~PcmAudioData()
 {
     delete _leftChannelData;
     delete _rightChannelData;
+    delete _monoData;
 }
 
 bool PcmAudioData::isStereo() const
 {
     return _leftChannelData != nullptr && _rightChannelData != nullptr;
 }
+
+bool PcmAudioData::isMono() const
+{
+    return _monoData != nullptr;
+}
@@ -12,14 +12,23 @@ public:
     ~PcmAudioData();
 
     bool isStereo() const;
+    bool isMono() const;
 
     const QVector<qint16> *leftChannelData() const { return _leftChannelData; }
-    void setLeftChannelData(const QVector<qint16> *data) { _leftChannelData = data; };
+    QVector<qint16> *leftChannelData() { return _leftChannelData; }
+    void setLeftChannelData(QVector<qint16> *data) { _leftChannelData = data; };
 
     const QVector<qint16> *rightChannelData() const { return _rightChannelData; };
-    void setRightChannelData(const QVector<qint16> *data) { _rightChannelData = data; };
+    QVector<qint16> *rightChannelData() { return _rightChannelData; }
+    void setRightChannelData(QVector<qint16> *data) { _rightChannelData = data; };
+
+    // Average of the channels, set instead of them when the decoder mixes the audio down
+    const QVector<qint16> *monoData() const { return _monoData; }
+    QVector<qint16> *monoData() { return _monoData; }
+    void setMonoData(QVector<qint16> *data) { _monoData = data; }
 
 private:
-    const QVector<qint16> *_leftChannelData = nullptr;
-    const QVector<qint16> *_rightChannelData = nullptr;
+    QVector<qint16> *_leftChannelData = nullptr;
+    QVector<qint16> *_rightChannelData = nullptr;
+    QVector<qint16> *_monoData = nullptr;
 };
@@ -0,0 +1,212 @@
+#include "pipelinestats.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+// Trivially initialized, so reading them never allocates, not even from within an allocation
+static thread_local PipelineStats *currentStats = nullptr;
+static thread_local qint64 allocationsCount = 0;
+
+// Qt containers allocate with malloc() rather than operator new, so allocations are counted by wrapping
+// malloc() itself. This replaces the allocator of the whole process and does not work with sanitizers,
+// so it is built only on request, see VSPlayer.pro
+#if defined(VSPLAYER_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+#define COUNTS_ALLOCATIONS
+
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *pointer, size_t size);
+
+    void *malloc(size_t size)
+    {
+        allocationsCount++;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        allocationsCount++;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, size_t size)
+    {
+        allocationsCount++;
+        return __libc_realloc(pointer, size);
+    }
+}
+#endif
+
+static qint64 nanosecondsSinceStart()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer startedTimer;
+        startedTimer.start();
+        return startedTimer;
+    }();
+
+    return timer.nsecsElapsed();
+}
+
+PipelineStats::Recording::Recording(PipelineStats *stats)
+    : _previousStats(currentStats)
+{
+    currentStats = stats;
+}
+
+PipelineStats::Recording::~Recording()
+{
+    currentStats = _previousStats;
+}
+
+PipelineStats::StageTimer::StageTimer(const Stage stage)
+    : _stats(currentStats),
+      _stage(stage)
+{
+    if (_stats != nullptr)
+    {
+        _startAllocations = allocationsCount;
+        _startNs = nanosecondsSinceStart();
+    }
+}
+
+PipelineStats::StageTimer::~StageTimer()
+{
+    if (_stats != nullptr)
+    {
+        const auto durationNs = nanosecondsSinceStart() - _startNs;
+        _stats->record(_stage, _startNs, durationNs, _bytes, _frames, allocationsCount - _startAllocations);
+    }
+}
+
+PipelineStats::PipelineStats(const QString &filePath, const bool withTraceEvents)
+    : _filePath(filePath),
+      _withTraceEvents(withTraceEvents),
+      _stages(StagesCount, StageStats())
+{
+}
+
+const char *PipelineStats::stageName(const Stage stage)
+{
+    switch (stage)
+    {
+    case CacheLoad:
+        return "cache load";
+    case MediaDecoding:
+        return "media decoding";
+    case WavReading:
+        return "wav reading";
+    case ChannelSplit:
+        return "channel split";
+    case SpectrumAnalysis:
+        return "spectrogram";
+    case CacheStore:
+        return "cache store";
+    case FingerprintExtraction:
+        return "fingerprint extraction";
+    case IndexInsertion:
+        return "index insertion";
+    case CsvExport:
+        return "csv export";
+    default:
+        return "unknown";
+    }
+}
+
+void PipelineStats::merge(const PipelineStats &other, const bool withTraceEvents)
+{
+    for (auto stage = 0; stage < StagesCount; stage++)
+    {
+        _stages[stage].calls += other._stages[stage].calls;
+        _stages[stage].wallTimeNs += other._stages[stage].wallTimeNs;
+        _stages[stage].bytes += other._stages[stage].bytes;
+        _stages[stage].frames += other._stages[stage].frames;
+        _stages[stage].allocations += other._stages[stage].allocations;
+    }
+
+    if (withTraceEvents)
+    {
+        _traceEvents += other._traceEvents;
+    }
+}
+
+void PipelineStats::clear()
+{
+    _stages.fill(StageStats());
+    _traceEvents.clear();
+}
+
+bool PipelineStats::writeChromeTrace(const QString &filePath) const
+{
+    QJsonArray traceEvents;
+    for (const auto &traceEvent : _traceEvents)
+    {
+        // Complete events ("X") in microseconds, a row per thread
+        QJsonObject args;
+        args.insert("file", traceEvent.filePath);
+        args.insert("bytes", static_cast<double>(traceEvent.bytes));
+        args.insert("frames", static_cast<double>(traceEvent.frames));
+
+        QJsonObject event;
+        event.insert("name", QString::fromLatin1(stageName(traceEvent.stage)));
+        event.insert("cat", QStringLiteral("analysis"));
+        event.insert("ph", QStringLiteral("X"));
+        event.insert("pid", 1);
+        event.insert("tid", static_cast<double>(traceEvent.threadId));
+        event.insert("ts", traceEvent.startNs / 1000.0);
+        event.insert("dur", traceEvent.durationNs / 1000.0);
+        event.insert("args", args);
+
+        traceEvents.append(event);
+    }
+
+    QJsonObject trace;
+    trace.insert("traceEvents", traceEvents);
+    trace.insert("displayTimeUnit", QStringLiteral("ms"));
+
+    QFile file(filePath);
+    const auto json = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+
+    return file.open(QIODevice::WriteOnly) && file.write(json) == json.size();
+}
+
+bool PipelineStats::countsAllocations()
+{
+#if defined(COUNTS_ALLOCATIONS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+qint64 PipelineStats::threadAllocationsCount()
+{
+    return allocationsCount;
+}
+
+void PipelineStats::record(
+    const Stage stage,
+    const qint64 startNs,
+    const qint64 durationNs,
+    const qint64 bytes,
+    const qint64 frames,
+    const qint64 allocations)
+{
+    auto &stageStats = _stages[stage];
+    stageStats.calls++;
+    stageStats.wallTimeNs += durationNs;
+    stageStats.bytes += bytes;
+    stageStats.frames += frames;
+    stageStats.allocations += allocations;
+
+    if (_withTraceEvents)
+    {
+        _traceEvents.append({stage, _filePath, reinterpret_cast<quintptr>(QThread::currentThreadId()), startNs, durationNs, bytes, frames});
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+// Wall time, data and heap allocations of every stage of the analysis of files, to tell which stage
+// slows indexing down. Stages are measured by StageTimer objects placed in the code of the stages,
+// which record into the stats installed on their thread by a Recording and do nothing otherwise.
+// A timer costs two clock reads and an allocation counter read, so measuring stays on in production.
+// Allocations are counted only in builds made with CONFIG+=count_allocations and are 0 otherwise.
+class PipelineStats
+{
+public:
+    enum Stage
+    {
+        // Loading the spectrogram from the analysis cache
+        CacheLoad,
+        // ffmpeg or the FFmpeg libraries decoding the media file, including waiting for the ffmpeg process
+        MediaDecoding,
+        // Parsing the temporary .wav file written by ffmpeg
+        WavReading,
+        // Splitting decoded frames into channels or mixing them down
+        ChannelSplit,
+        SpectrumAnalysis,
+        CacheStore,
+        FingerprintExtraction,
+        IndexInsertion,
+        CsvExport,
+        StagesCount
+    };
+
+    struct StageStats
+    {
+        qint64 calls;
+        qint64 wallTimeNs;
+        qint64 bytes;
+        qint64 frames;
+        // Heap allocations made on the thread of the stage while it ran, if countsAllocations()
+        qint64 allocations;
+    };
+
+    // A single run of a stage, as shown by trace viewers
+    struct TraceEvent
+    {
+        Stage stage;
+        QString filePath;
+        quintptr threadId;
+        qint64 startNs;
+        qint64 durationNs;
+        qint64 bytes;
+        qint64 frames;
+    };
+
+    // Makes the stats the target of the stage timers of the current thread while it exists
+    class Recording final
+    {
+    public:
+        explicit Recording(PipelineStats *stats);
+        ~Recording();
+        Recording(const Recording &) = delete;
+        Recording &operator=(const Recording &) = delete;
+
+    private:
+        PipelineStats *_previousStats;
+    };
+
+    // Measures a stage from its construction to its destruction.
+    // Stages may nest, e.g. the channel split runs within the media decoding while ffmpeg streams its output
+    class StageTimer final
+    {
+    public:
+        explicit StageTimer(Stage stage);
+        ~StageTimer();
+        StageTimer(const StageTimer &) = delete;
+        StageTimer &operator=(const StageTimer &) = delete;
+
+        void addBytes(qint64 bytes) { _bytes += bytes; }
+        void addFrames(qint64 frames) { _frames += frames; }
+
+    private:
+        PipelineStats *_stats;
+        Stage _stage;
+        qint64 _startNs = 0;
+        qint64 _startAllocations = 0;
+        qint64 _bytes = 0;
+        qint64 _frames = 0;
+    };
+
+    // Trace events are kept only if withTraceEvents is true, since they grow with every stage run
+    explicit PipelineStats(const QString &filePath = QString(), bool withTraceEvents = false);
+
+    static const char *stageName(Stage stage);
+
+    // File whose analysis is measured, empty for the totals of several files
+    QString filePath() const { return _filePath; }
+
+    const StageStats &stage(Stage stage) const { return _stages[stage]; }
+    const QVector<TraceEvent> &traceEvents() const { return _traceEvents; }
+
+    // Adds the measurements of the other stats to these, with its trace events if withTraceEvents is true
+    void merge(const PipelineStats &other, bool withTraceEvents);
+    void clear();
+
+    // Writes the trace events in the Chrome trace event format, viewed with chrome://tracing or Perfetto
+    bool writeChromeTrace(const QString &filePath) const;
+
+    // True if the build counts heap allocations
+    static bool countsAllocations();
+
+    // Heap allocations made on the current thread since it started, if countsAllocations()
+    static qint64 threadAllocationsCount();
+
+private:
+    QString _filePath;
+    bool _withTraceEvents;
+    QVector<StageStats> _stages;
+    QVector<TraceEvent> _traceEvents;
+
+    void record(Stage stage, qint64 startNs, qint64 durationNs, qint64 bytes, qint64 frames, qint64 allocations);
+};
+Q_DECLARE_METATYPE(PipelineStats)
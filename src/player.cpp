@@ -19,6 +19,19 @@ Player::Player(QWidget *parent)
     _audioSearchEngine = new AudioSearchEngine(this);
 
     connect(_audioSearchEngine, &AudioSearchEngine::error, this, &Player::displayErrorMessage);
+    connect(_audioSearchEngine, &AudioSearchEngine::analysisProgress, this, [=](const QString &filePath, int percent) {
+        setStatusInfo(tr("Analyzing %1 %2%").arg(QFileInfo(filePath).fileName()).arg(percent));
+    });
+    connect(_audioSearchEngine, &AudioSearchEngine::analysisFinished, this, [=]() {
+        if (_audioSearchEngine->pendingAnalysesCount() == 0)
+            setStatusInfo(QString());
+    });
+    connect(_audioSearchEngine, &AudioSearchEngine::searchMatchFound, this, &Player::jumpToMatch);
+    connect(_audioSearchEngine, &AudioSearchEngine::searchFinished, this, [=](const FingerprintMatch &bestMatch) {
+        _listenButton->setChecked(_audioSearchEngine->isLiveSearchActive());
+        if (bestMatch.trackPath.isEmpty())
+            setStatusInfo(tr("No match found"));
+    });
 
     _playlist = new QMediaPlaylist();
     _player->setPlaylist(_playlist);
@@ -54,6 +67,20 @@ Player::Player(QWidget *parent)
 
     connect(openButton, &QPushButton::clicked, this, &Player::open);
 
+    QPushButton *searchButton = new QPushButton(tr("Search..."), this);
+    connect(searchButton, &QPushButton::clicked, this, &Player::searchByClip);
+
+    _listenButton = new QPushButton(tr("Listen"), this);
+    _listenButton->setCheckable(true);
+    connect(_listenButton, &QPushButton::clicked, this, [=](bool checked) {
+        if (checked) {
+            setStatusInfo(tr("Listening..."));
+            _audioSearchEngine->startLiveSearch();
+        } else {
+            _audioSearchEngine->stopLiveSearch();
+        }
+    });
+
     PlayerControls *controls = new PlayerControls(this);
     controls->setState(_player->state());
     controls->setVolume(_player->volume());
@@ -87,6 +114,8 @@ Player::Player(QWidget *parent)
     QBoxLayout *controlLayout = new QHBoxLayout;
     controlLayout->setMargin(0);
     controlLayout->addWidget(openButton);
+    controlLayout->addWidget(searchButton);
+    controlLayout->addWidget(_listenButton);
     controlLayout->addStretch(1);
     controlLayout->addWidget(controls);
     controlLayout->addStretch(1);
@@ -110,6 +139,8 @@ Player::Player(QWidget *parent)
         controls->setEnabled(false);
         _playlistView->setEnabled(false);
         openButton->setEnabled(false);
+        searchButton->setEnabled(false);
+        _listenButton->setEnabled(false);
         _colorButton->setEnabled(false);
         _fullScreenButton->setEnabled(false);
     }
@@ -141,6 +172,41 @@ void Player::open()
         addToPlaylist(fileDialog.selectedUrls());
 }
 
+void Player::searchByClip()
+{
+    const auto clipFilePath = QFileDialog::getOpenFileName(this, tr("Search by Clip"),
+        QStandardPaths::standardLocations(QStandardPaths::MusicLocation).value(0, QDir::homePath()));
+    if (clipFilePath.isEmpty())
+        return;
+
+    setStatusInfo(tr("Searching..."));
+    _audioSearchEngine->search(clipFilePath);
+}
+
+void Player::jumpToMatch(const FingerprintMatch &match, double confidence, qint64 latencyMs)
+{
+    auto trackIndex = -1;
+    for (auto i = 0; i < _playlist->mediaCount() && trackIndex < 0; i++) {
+        const auto url = _playlist->media(i).canonicalUrl();
+        if (url.isLocalFile() && QFileInfo(url.toLocalFile()).absoluteFilePath() == match.trackPath)
+            trackIndex = i;
+    }
+
+    if (trackIndex < 0) {
+        _playlist->addMedia(QUrl::fromLocalFile(match.trackPath));
+        trackIndex = _playlist->mediaCount() - 1;
+    }
+
+    // The track heard by the live search went on playing while it was being searched for
+    const auto positionMs = _listenButton->isChecked() ? match.offsetMs + latencyMs : match.offsetMs;
+
+    _playlist->setCurrentIndex(trackIndex);
+    _player->setPosition(positionMs);
+    _player->play();
+
+    setStatusInfo(tr("Found in %1 ms, %2% confidence").arg(latencyMs).arg(qRound(confidence * 100)));
+}
+
 static bool isValidUrl(const QUrl &url) // Check for ".m3u" playlists.
 {
     if (!url.isLocalFile()) {
@@ -158,6 +224,7 @@ void Player::addToPlaylist(const QList<QUrl> &urls)
     for (auto &url: urls) {
         if (isValidUrl(url)) {
             _playlist->addMedia(url);
+            // Analysis runs on the worker threads of the engine, so adding files does not block the player
             _audioSearchEngine->analyze(url.toLocalFile());
         }
     }
@@ -57,6 +57,9 @@ private slots:
 
     void showColorDialog();
 
+    void searchByClip();
+    void jumpToMatch(const FingerprintMatch &match, double confidence, qint64 latencyMs);
+
 private:
     void setTrackInfo(const QString &info);
     void setStatusInfo(const QString &info);
@@ -71,6 +74,7 @@ private:
     QLabel *_labelDuration = nullptr;
     QPushButton *_fullScreenButton = nullptr;
     QPushButton *_colorButton = nullptr;
+    QPushButton *_listenButton = nullptr;
     QDialog *_colorDialog = nullptr;
     QLabel *_statusLabel = nullptr;
     QStatusBar *_statusBar = nullptr;
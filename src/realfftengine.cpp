@@ -0,0 +1,61 @@
+#include "realfftengine.h"
+#include "spectrumanalyzerexception.h"
+
+#include <qmath.h>
+
+template<typename T>
+RealFftEngine<T>::RealFftEngine(const int size, const SimdKernels &kernels)
+    : _size(size),
+      _halfSizeEngine(size < 2 ? 1 : size >> 1, kernels)
+{
+    if (size < 2 || !isPowerOfTwo(size))
+    {
+        throw SpectrumAnalyzerException("Real FFT size should be a power of 2 not less than 2");
+    }
+
+    const auto quarterSize = size >> 2;
+    _unpackTwiddles.resize(quarterSize + 1);
+    for (auto k = 0; k <= quarterSize; k++)
+    {
+        const auto angle = -2 * M_PI * k / size;
+        _unpackTwiddles[k] = Complex(cos(angle), sin(angle));
+    }
+}
+
+template<typename T>
+void RealFftEngine<T>::transform(Complex *data) const
+{
+    _halfSizeEngine.transform(data);
+    unpack(data);
+}
+
+template<typename T>
+void RealFftEngine<T>::unpack(Complex *data) const
+{
+    // Z is the spectrum of packed z[n] = x[2n] + i * x[2n + 1], M = N / 2. Then
+    //   E[k] = (Z[k] + conj(Z[M - k])) / 2       - spectrum of even samples
+    //   O[k] = (Z[k] - conj(Z[M - k])) / (2i)    - spectrum of odd samples
+    //   X[k] = E[k] + W^k * O[k],  X[M - k] = conj(E[k] - W^k * O[k])
+    // so the bins k and M - k are unpacked in place from the same pair of inputs
+    const auto halfSize = _size >> 1;
+
+    const auto z0 = data[0];
+    data[0] = Complex(z0.real() + z0.imag(), 0);
+    data[halfSize] = Complex(z0.real() - z0.imag(), 0);
+
+    for (auto k = 1; k <= (halfSize >> 1); k++)
+    {
+        const auto a = data[k];
+        const auto b = std::conj(data[halfSize - k]);
+
+        const auto even = (a + b) * T(0.5);
+        const auto odd = (a - b) * Complex(0, -0.5);
+        const auto rotatedOdd = _unpackTwiddles[k] * odd;
+
+        data[k] = even + rotatedOdd;
+        data[halfSize - k] = std::conj(even - rotatedOdd);
+    }
+}
+
+template class RealFftEngine<double>;
+template class RealFftEngine<float>;
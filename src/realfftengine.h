@@ -0,0 +1,32 @@
+#pragma once
+
+#include "fftengine.h"
+
+// FFT of real input of a power-of-two size N.
+// N real samples are packed as N/2 complex values (even samples as real parts,
+// odd samples as imaginary parts), transformed by a half-size FftEngine and
+// unpacked using the Hermitian symmetry of the real signal spectrum.
+// The result holds N/2 + 1 bins: from 0 to the Nyquist frequency inclusive.
+template<typename T>
+class RealFftEngine final
+{
+public:
+    typedef std::complex<T> Complex;
+
+    explicit RealFftEngine(int size, const SimdKernels &kernels = SimdKernels::best());
+
+    int size() const { return _size; }
+    int spectrumSize() const { return (_size >> 1) + 1; }
+
+    // data holds size/2 packed complex values on input and spectrumSize() bins on output
+    void transform(Complex *data) const;
+
+private:
+    int _size;
+    FftEngine<T> _halfSizeEngine;
+
+    // e^(-2*pi*i*k/size) for k in [0, size/4]
+    QVector<Complex> _unpackTwiddles;
+
+    void unpack(Complex *data) const;
+};
@@ -0,0 +1,79 @@
+#include "scratcharena.h"
+
+#include <new>
+
+const qint64 ScratchArena::DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+static thread_local ScratchArena *currentArena = nullptr;
+
+ScratchArena::Scope::Scope(ScratchArena *arena)
+    : _previousArena(currentArena)
+{
+    currentArena = arena;
+}
+
+ScratchArena::Scope::~Scope()
+{
+    currentArena = _previousArena;
+}
+
+ScratchArena::ScratchArena(const qint64 chunkSize)
+    : _chunkSize(chunkSize)
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    release();
+}
+
+void *ScratchArena::allocate(const qint64 size)
+{
+    const auto alignedSize = (qMax(size, static_cast<qint64>(1)) + ALIGNMENT - 1) & ~static_cast<qint64>(ALIGNMENT - 1);
+
+    if (_position == nullptr || alignedSize > _end - _position)
+    {
+        // Chunks are only aligned to what operator new guarantees, so the first buffer may need to skip ahead
+        const auto chunkSize = qMax(_chunkSize, alignedSize) + ALIGNMENT;
+        const auto data = static_cast<char *>(::operator new(static_cast<size_t>(chunkSize)));
+
+        _chunks.append({data, chunkSize});
+
+        const auto alignedData = reinterpret_cast<char *>(
+            (reinterpret_cast<quintptr>(data) + ALIGNMENT - 1) & ~static_cast<quintptr>(ALIGNMENT - 1));
+
+        // An oversized buffer fills its chunk, and the free space of the previous chunk stays in use
+        if (alignedSize > _chunkSize && _position != nullptr)
+        {
+            _allocatedBytes += alignedSize;
+            return alignedData;
+        }
+
+        _position = alignedData;
+        _end = data + chunkSize;
+    }
+
+    const auto buffer = _position;
+    _position += alignedSize;
+    _allocatedBytes += alignedSize;
+
+    return buffer;
+}
+
+void ScratchArena::release()
+{
+    for (const auto &chunk : _chunks)
+    {
+        ::operator delete(chunk.data);
+    }
+
+    _chunks.clear();
+    _position = nullptr;
+    _end = nullptr;
+    _allocatedBytes = 0;
+}
+
+ScratchArena *ScratchArena::current()
+{
+    return currentArena;
+}
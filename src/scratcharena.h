@@ -0,0 +1,110 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QVector>
+#include <type_traits>
+
+// Bump allocator for the temporary buffers of a single analysis. Buffers are carved one after another
+// out of large chunks and are never freed one by one: all of them are released at once with the arena,
+// so an analysis costs a few chunk allocations instead of one heap allocation per buffer,
+// and analyses running in parallel do not contend for the heap.
+// An arena belongs to one thread. Code of the analysis draws from it through ScratchBuffer
+// while a Scope installs it on the thread.
+class ScratchArena final
+{
+public:
+    static const qint64 DEFAULT_CHUNK_SIZE;
+    // Every buffer starts on a cache line, which also suits any SIMD load
+    static const int ALIGNMENT = 64;
+
+    // Makes the arena the one ScratchBuffer draws from on the current thread while it exists
+    class Scope final
+    {
+    public:
+        explicit Scope(ScratchArena *arena);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        ScratchArena *_previousArena;
+    };
+
+    explicit ScratchArena(qint64 chunkSize = DEFAULT_CHUNK_SIZE);
+    ~ScratchArena();
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    // Uninitialized memory of the size, valid until the arena is released.
+    // Sizes larger than a chunk get a chunk of their own
+    void *allocate(qint64 size);
+
+    // Frees every buffer at once
+    void release();
+
+    qint64 allocatedBytes() const { return _allocatedBytes; }
+    int chunksCount() const { return _chunks.count(); }
+
+    // Arena installed on the current thread, or nullptr
+    static ScratchArena *current();
+
+private:
+    struct Chunk
+    {
+        char *data;
+        qint64 size;
+    };
+
+    qint64 _chunkSize;
+    QVector<Chunk> _chunks;
+    // Free space of the last regular chunk
+    char *_position = nullptr;
+    char *_end = nullptr;
+    qint64 _allocatedBytes = 0;
+};
+
+// Uninitialized temporary array drawn from the arena of the current thread,
+// or from the heap and freed with the buffer when no arena is installed, e.g. outside of an analysis
+template<typename T>
+class ScratchBuffer final
+{
+    static_assert(std::is_trivially_destructible<T>::value, "Arena memory is released without destroying its values");
+
+public:
+    explicit ScratchBuffer(int count);
+    ~ScratchBuffer();
+    ScratchBuffer(const ScratchBuffer &) = delete;
+    ScratchBuffer &operator=(const ScratchBuffer &) = delete;
+
+    int count() const { return _count; }
+    T *data() { return _data; }
+    const T *constData() const { return _data; }
+
+    T &operator[](const int i) { return _data[i]; }
+    const T &operator[](const int i) const { return _data[i]; }
+
+private:
+    T *_data;
+    int _count;
+    bool _ownsData;
+};
+
+template<typename T>
+ScratchBuffer<T>::ScratchBuffer(const int count)
+    : _count(count)
+{
+    const auto size = static_cast<qint64>(count) * static_cast<qint64>(sizeof(T));
+    const auto arena = ScratchArena::current();
+
+    _ownsData = arena == nullptr;
+    _data = static_cast<T *>(_ownsData ? ::operator new(static_cast<size_t>(size)) : arena->allocate(size));
+}
+
+template<typename T>
+ScratchBuffer<T>::~ScratchBuffer()
+{
+    if (_ownsData)
+    {
+        ::operator delete(_data);
+    }
+}
@@ -0,0 +1,166 @@
+#include "shardedfingerprintindex.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+
+ShardedFingerprintIndex::ShardedFingerprintIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ShardedFingerprintIndex::~ShardedFingerprintIndex()
+{
+}
+
+void ShardedFingerprintIndex::addShard(const FingerprintIndex *fingerprintIndex)
+{
+    const QWriteLocker locker(&_lock);
+    _shards.append(fingerprintIndex);
+}
+
+bool ShardedFingerprintIndex::loadShard(const QString &filePath)
+{
+    const QSharedPointer<FingerprintIndex> fingerprintIndex(new FingerprintIndex());
+    if (!fingerprintIndex->load(filePath))
+    {
+        return false;
+    }
+
+    const QWriteLocker locker(&_lock);
+
+    if (!_shards.isEmpty()
+        && (fingerprintIndex->sampleRate() != _shards.first()->sampleRate() || fingerprintIndex->hopSize() != _shards.first()->hopSize()))
+    {
+        return false;
+    }
+
+    _loadedShards.append(fingerprintIndex);
+    _shards.append(fingerprintIndex.data());
+
+    return true;
+}
+
+void ShardedFingerprintIndex::clear()
+{
+    const QWriteLocker locker(&_lock);
+    _shards.clear();
+    _loadedShards.clear();
+}
+
+int ShardedFingerprintIndex::shardsCount() const
+{
+    const QReadLocker locker(&_lock);
+    return _shards.count();
+}
+
+QVector<FingerprintMatch> ShardedFingerprintIndex::search(const Fingerprints &clipFingerprints, const int maxMatches) const
+{
+    Votes votes;
+    return search(clipFingerprints, maxMatches, &votes);
+}
+
+QVector<FingerprintMatch> ShardedFingerprintIndex::search(const Fingerprints &clipFingerprints, const int maxMatches, Votes *votes) const
+{
+    const QReadLocker locker(&_lock);
+
+    QVector<QFuture<QHash<quint64, int>>> tasks;
+    for (auto shard = 1; shard < _shards.count(); shard++)
+    {
+        const auto fingerprintIndex = _shards[shard];
+        tasks.append(QtConcurrent::run([=, &clipFingerprints]() {
+            QHash<quint64, int> shardVotes;
+            fingerprintIndex->vote(clipFingerprints, &shardVotes);
+            return shardVotes;
+        }));
+    }
+
+    if (_shards.isEmpty())
+    {
+        return QVector<FingerprintMatch>();
+    }
+
+    // The calling thread searches the first shard instead of waiting idle
+    QHash<quint64, int> firstShardVotes;
+    _shards.first()->vote(clipFingerprints, &firstShardVotes);
+    addShardVotes(_shards.first(), firstShardVotes, votes);
+
+    for (auto task = 0; task < tasks.count(); task++)
+    {
+        addShardVotes(_shards[task + 1], tasks[task].result(), votes);
+    }
+
+    const auto sampleRate = _shards.first()->sampleRate();
+    const auto hopSize = _shards.first()->hopSize();
+
+    QVector<FingerprintMatch> matches;
+    matches.reserve(votes->_tracks.count());
+    for (const auto &track : votes->_tracks)
+    {
+        // A clip starting before the track gets negative differences from its first seconds
+        const auto frameDelta = static_cast<qint64>(qMax(0, track.best.frameDelta));
+        const auto offsetMs = sampleRate == 0 ? 0 : frameDelta * hopSize * 1000 / sampleRate;
+        matches.append({track.trackId, track.trackPath, offsetMs, track.best.votes});
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const FingerprintMatch &a, const FingerprintMatch &b) {
+        return a.votes != b.votes ? a.votes > b.votes : a.trackPath < b.trackPath;
+    });
+
+    if (matches.count() > maxMatches)
+    {
+        matches.resize(qMax(0, maxMatches));
+    }
+
+    return matches;
+}
+
+void ShardedFingerprintIndex::addShardVotes(const FingerprintIndex *shard, const QHash<quint64, int> &shardVotes, Votes *votes)
+{
+    auto &shardTrackIndexes = votes->_shardTrackIndexes[shard];
+
+    for (auto it = shardVotes.constBegin(); it != shardVotes.constEnd(); ++it)
+    {
+        const auto trackId = static_cast<int>(it.key() >> 32);
+        const auto frameDelta = static_cast<qint32>(static_cast<quint32>(it.key()));
+
+        while (shardTrackIndexes.count() <= trackId)
+        {
+            shardTrackIndexes.append(-1);
+        }
+
+        if (shardTrackIndexes[trackId] < 0)
+        {
+            const auto trackPath = shard->trackPath(static_cast<quint32>(trackId));
+
+            auto trackIndex = votes->_trackIndexesByPath.value(trackPath, -1);
+            if (trackIndex < 0)
+            {
+                trackIndex = votes->_tracks.count();
+                votes->_tracks.append({static_cast<quint32>(trackId), trackPath, {0, 0}});
+                votes->_trackIndexesByPath.insert(trackPath, trackIndex);
+            }
+
+            shardTrackIndexes[trackId] = votes->_shardTracks.count();
+            votes->_shardTracks.append({0, 0});
+            votes->_trackIndexes.append(trackIndex);
+        }
+
+        // Shards holding the same track find the same fingerprints, so the track gets the votes of its best
+        // shard rather than their sum
+        const auto shardTrackIndex = shardTrackIndexes[trackId];
+        auto &frameDeltaVotes = votes->_votes[static_cast<quint64>(shardTrackIndex) << 32 | static_cast<quint32>(frameDelta)];
+        frameDeltaVotes += it.value();
+
+        auto &shardTrack = votes->_shardTracks[shardTrackIndex];
+        if (frameDeltaVotes > shardTrack.votes)
+        {
+            shardTrack = {frameDeltaVotes, frameDelta};
+        }
+
+        auto &track = votes->_tracks[votes->_trackIndexes[shardTrackIndex]];
+        if (shardTrack.votes > track.best.votes)
+        {
+            track.best = shardTrack;
+        }
+    }
+}
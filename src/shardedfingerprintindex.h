@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QObject>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QVector>
+#include "fingerprintindex.h"
+
+// Fingerprint indexes searched together, e.g. the shards built separately for a library too large for one index.
+// A clip is searched in all shards at once and their votes are merged.
+// Track ids of the matches are only unique within their shard, so tracks are told apart by their paths,
+// and a track found in several shards is matched once.
+// All methods may be called from several threads at once.
+class ShardedFingerprintIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Votes of a clip searched a piece at a time, e.g. while it is still arriving, so every fingerprint is looked up once
+    class Votes final
+    {
+    private:
+        friend class ShardedFingerprintIndex;
+
+        // Best aligned frame difference of a track, in one shard or in all of them
+        struct TrackVotes
+        {
+            int votes;
+            qint32 frameDelta;
+        };
+
+        struct Track
+        {
+            quint32 trackId;
+            QString trackPath;
+            TrackVotes best;
+        };
+
+        // Tracks of the shards, by their id in the shard, and the tracks they are, by their path
+        QHash<const FingerprintIndex *, QVector<int>> _shardTrackIndexes;
+        QVector<int> _trackIndexes;
+        QVector<TrackVotes> _shardTracks;
+        QHash<QString, int> _trackIndexesByPath;
+        QVector<Track> _tracks;
+
+        // Votes of the shard tracks by the frame difference, packed into the upper and lower halves of the key
+        QHash<quint64, int> _votes;
+    };
+
+    explicit ShardedFingerprintIndex(QObject *parent = nullptr);
+    ~ShardedFingerprintIndex();
+
+    // Searches an index owned by someone else, which has to outlive this one
+    void addShard(const FingerprintIndex *fingerprintIndex);
+
+    // Maps the index file as a shard. Returns false if it is missing, damaged
+    // or framed differently than the shards added before
+    bool loadShard(const QString &filePath);
+
+    void clear();
+
+    int shardsCount() const;
+
+    // The best matches of all shards, the best one first
+    QVector<FingerprintMatch> search(const Fingerprints &clipFingerprints, int maxMatches = 1) const;
+
+    // Adds the votes of the clip fingerprints to the ones of the fingerprints searched before and returns
+    // the best matches of all of them
+    QVector<FingerprintMatch> search(const Fingerprints &clipFingerprints, int maxMatches, Votes *votes) const;
+
+private:
+    mutable QReadWriteLock _lock;
+
+    QVector<const FingerprintIndex *> _shards;
+    QVector<QSharedPointer<FingerprintIndex>> _loadedShards;
+
+    static void addShardVotes(const FingerprintIndex *shard, const QHash<quint64, int> &shardVotes, Votes *votes);
+};
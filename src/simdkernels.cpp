@@ -0,0 +1,651 @@
+#include "simdkernels.h"
+
+#include <qmath.h>
+
+// SSE2 is a part of the x86-64 baseline, so only 64-bit builds get vectorized kernels
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile AVX2 intrinsics only in functions explicitly targeted at AVX2,
+// MSVC compiles them everywhere
+#if defined(SIMD_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace
+{
+    // Scalar reference implementation
+
+    template<typename T>
+    void butterflyScalar(std::complex<T> *even, std::complex<T> *odd, const std::complex<T> *twiddles, const int count)
+    {
+        for (auto k = 0; k < count; k++)
+        {
+            const auto t = odd[k] * twiddles[k];
+            odd[k] = even[k] - t;
+            even[k] = even[k] + t;
+        }
+    }
+
+    template<typename T>
+    void magnitudeScalar(const std::complex<T> *spectra, float *magnitudes, const int count)
+    {
+        for (auto k = 0; k < count; k++)
+        {
+            const auto real = spectra[k].real();
+            const auto imag = spectra[k].imag();
+
+            magnitudes[k] = sqrt(real * real + imag * imag);
+        }
+    }
+
+    template<typename T>
+    void int16ToRealScalar(const qint16 *samples, T *values, const int count)
+    {
+        for (auto k = 0; k < count; k++)
+        {
+            values[k] = samples[k];
+        }
+    }
+
+    template<typename T>
+    void int16ToComplexScalar(const qint16 *samples, std::complex<T> *values, const int count)
+    {
+        for (auto k = 0; k < count; k++)
+        {
+            values[k] = std::complex<T>(samples[k], 0);
+        }
+    }
+
+    void deinterleaveStereoScalar(const qint16 *frames, qint16 *left, qint16 *right, const int framesCount)
+    {
+        for (auto k = 0; k < framesCount; k++)
+        {
+            left[k] = frames[2 * k];
+            right[k] = frames[2 * k + 1];
+        }
+    }
+
+    void downmixStereoScalar(const qint16 *frames, qint16 *mono, const int framesCount)
+    {
+        for (auto k = 0; k < framesCount; k++)
+        {
+            mono[k] = static_cast<qint16>((frames[2 * k] + frames[2 * k + 1]) >> 1);
+        }
+    }
+
+#ifdef SIMD_KERNELS_X86
+
+    // SSE2, double precision: one complex value per register
+
+    inline __m128d multiplyComplexSse2(const __m128d a, const __m128d b)
+    {
+        const auto bReal = _mm_unpacklo_pd(b, b);
+        const auto bImag = _mm_unpackhi_pd(b, b);
+        const auto aSwapped = _mm_shuffle_pd(a, a, 1);
+        const auto signs = _mm_set_pd(1.0, -1.0);
+
+        // (ar * br - ai * bi, ai * br + ar * bi)
+        return _mm_add_pd(_mm_mul_pd(a, bReal), _mm_mul_pd(_mm_mul_pd(aSwapped, bImag), signs));
+    }
+
+    void butterflySse2(complex *even, complex *odd, const complex *twiddles, const int count)
+    {
+        const auto evenData = reinterpret_cast<double *>(even);
+        const auto oddData = reinterpret_cast<double *>(odd);
+        const auto twiddlesData = reinterpret_cast<const double *>(twiddles);
+
+        for (auto k = 0; k < count; k++)
+        {
+            const auto e = _mm_loadu_pd(evenData + 2 * k);
+            const auto t = multiplyComplexSse2(_mm_loadu_pd(oddData + 2 * k), _mm_loadu_pd(twiddlesData + 2 * k));
+
+            _mm_storeu_pd(oddData + 2 * k, _mm_sub_pd(e, t));
+            _mm_storeu_pd(evenData + 2 * k, _mm_add_pd(e, t));
+        }
+    }
+
+    void magnitudeSse2(const complex *spectra, float *magnitudes, const int count)
+    {
+        const auto data = reinterpret_cast<const double *>(spectra);
+
+        auto k = 0;
+        for (; k + 2 <= count; k += 2)
+        {
+            const auto v0 = _mm_loadu_pd(data + 2 * k);
+            const auto v1 = _mm_loadu_pd(data + 2 * k + 2);
+            const auto squares0 = _mm_mul_pd(v0, v0);
+            const auto squares1 = _mm_mul_pd(v1, v1);
+
+            const auto sums = _mm_add_pd(_mm_unpacklo_pd(squares0, squares1), _mm_unpackhi_pd(squares0, squares1));
+            const auto result = _mm_cvtpd_ps(_mm_sqrt_pd(sums));
+
+            _mm_storel_pi(reinterpret_cast<__m64 *>(magnitudes + k), result);
+        }
+
+        magnitudeScalar<double>(spectra + k, magnitudes + k, count - k);
+    }
+
+    // Converts 8 samples to 4 + 4 sign-extended 32-bit integers
+    inline void int16ToInt32Sse2(const qint16 *samples, __m128i &low, __m128i &high)
+    {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples));
+        low = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        high = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    }
+
+    void int16ToDoubleSse2(const qint16 *samples, double *values, const int count)
+    {
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            __m128i low, high;
+            int16ToInt32Sse2(samples + k, low, high);
+
+            _mm_storeu_pd(values + k, _mm_cvtepi32_pd(low));
+            _mm_storeu_pd(values + k + 2, _mm_cvtepi32_pd(_mm_srli_si128(low, 8)));
+            _mm_storeu_pd(values + k + 4, _mm_cvtepi32_pd(high));
+            _mm_storeu_pd(values + k + 6, _mm_cvtepi32_pd(_mm_srli_si128(high, 8)));
+        }
+
+        int16ToRealScalar<double>(samples + k, values + k, count - k);
+    }
+
+    void int16ToComplexSse2(const qint16 *samples, complex *values, const int count)
+    {
+        const auto data = reinterpret_cast<double *>(values);
+        const auto zero = _mm_setzero_pd();
+
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            __m128i low, high;
+            int16ToInt32Sse2(samples + k, low, high);
+
+            const __m128d pairs[4] = {
+                _mm_cvtepi32_pd(low),
+                _mm_cvtepi32_pd(_mm_srli_si128(low, 8)),
+                _mm_cvtepi32_pd(high),
+                _mm_cvtepi32_pd(_mm_srli_si128(high, 8))
+            };
+
+            for (auto i = 0; i < 4; i++)
+            {
+                _mm_storeu_pd(data + 2 * (k + 2 * i), _mm_unpacklo_pd(pairs[i], zero));
+                _mm_storeu_pd(data + 2 * (k + 2 * i + 1), _mm_unpackhi_pd(pairs[i], zero));
+            }
+        }
+
+        int16ToComplexScalar<double>(samples + k, values + k, count - k);
+    }
+
+    // SSE2, single precision: two complex values per register
+
+    inline __m128 multiplyComplexFloatSse2(const __m128 a, const __m128 b)
+    {
+        const auto bReal = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 0, 0));
+        const auto bImag = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 1, 1));
+        const auto aSwapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+        const auto signs = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+
+        return _mm_add_ps(_mm_mul_ps(a, bReal), _mm_mul_ps(_mm_mul_ps(aSwapped, bImag), signs));
+    }
+
+    void butterflyFloatSse2(complexf *even, complexf *odd, const complexf *twiddles, const int count)
+    {
+        const auto evenData = reinterpret_cast<float *>(even);
+        const auto oddData = reinterpret_cast<float *>(odd);
+        const auto twiddlesData = reinterpret_cast<const float *>(twiddles);
+
+        auto k = 0;
+        for (; k + 2 <= count; k += 2)
+        {
+            const auto e = _mm_loadu_ps(evenData + 2 * k);
+            const auto t = multiplyComplexFloatSse2(_mm_loadu_ps(oddData + 2 * k), _mm_loadu_ps(twiddlesData + 2 * k));
+
+            _mm_storeu_ps(oddData + 2 * k, _mm_sub_ps(e, t));
+            _mm_storeu_ps(evenData + 2 * k, _mm_add_ps(e, t));
+        }
+
+        butterflyScalar<float>(even + k, odd + k, twiddles + k, count - k);
+    }
+
+    void magnitudeFloatSse2(const complexf *spectra, float *magnitudes, const int count)
+    {
+        const auto data = reinterpret_cast<const float *>(spectra);
+
+        auto k = 0;
+        for (; k + 4 <= count; k += 4)
+        {
+            const auto v0 = _mm_loadu_ps(data + 2 * k);
+            const auto v1 = _mm_loadu_ps(data + 2 * k + 4);
+            const auto squares0 = _mm_mul_ps(v0, v0);
+            const auto squares1 = _mm_mul_ps(v1, v1);
+
+            const auto reals = _mm_shuffle_ps(squares0, squares1, _MM_SHUFFLE(2, 0, 2, 0));
+            const auto imags = _mm_shuffle_ps(squares0, squares1, _MM_SHUFFLE(3, 1, 3, 1));
+
+            _mm_storeu_ps(magnitudes + k, _mm_sqrt_ps(_mm_add_ps(reals, imags)));
+        }
+
+        magnitudeScalar<float>(spectra + k, magnitudes + k, count - k);
+    }
+
+    void int16ToFloatSse2(const qint16 *samples, float *values, const int count)
+    {
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            __m128i low, high;
+            int16ToInt32Sse2(samples + k, low, high);
+
+            _mm_storeu_ps(values + k, _mm_cvtepi32_ps(low));
+            _mm_storeu_ps(values + k + 4, _mm_cvtepi32_ps(high));
+        }
+
+        int16ToRealScalar<float>(samples + k, values + k, count - k);
+    }
+
+    void int16ToComplexFloatSse2(const qint16 *samples, complexf *values, const int count)
+    {
+        const auto data = reinterpret_cast<float *>(values);
+        const auto zero = _mm_setzero_ps();
+
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            __m128i low, high;
+            int16ToInt32Sse2(samples + k, low, high);
+
+            const auto lowFloats = _mm_cvtepi32_ps(low);
+            const auto highFloats = _mm_cvtepi32_ps(high);
+
+            _mm_storeu_ps(data + 2 * k, _mm_unpacklo_ps(lowFloats, zero));
+            _mm_storeu_ps(data + 2 * k + 4, _mm_unpackhi_ps(lowFloats, zero));
+            _mm_storeu_ps(data + 2 * k + 8, _mm_unpacklo_ps(highFloats, zero));
+            _mm_storeu_ps(data + 2 * k + 12, _mm_unpackhi_ps(highFloats, zero));
+        }
+
+        int16ToComplexScalar<float>(samples + k, values + k, count - k);
+    }
+
+    // SSE2, stereo frames: four frames per register
+
+    // Sign-extends the left (low) and the right (high) halves of 32-bit stereo frames
+    inline void splitFramesSse2(const __m128i frames, __m128i &left, __m128i &right)
+    {
+        left = _mm_srai_epi32(_mm_slli_epi32(frames, 16), 16);
+        right = _mm_srai_epi32(frames, 16);
+    }
+
+    void deinterleaveStereoSse2(const qint16 *frames, qint16 *left, qint16 *right, const int framesCount)
+    {
+        auto k = 0;
+        for (; k + 8 <= framesCount; k += 8)
+        {
+            __m128i left0, right0, left1, right1;
+            splitFramesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 2 * k)), left0, right0);
+            splitFramesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 2 * k + 8)), left1, right1);
+
+            // The values fit into 16 bits, so the saturation of the packing never applies
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(left + k), _mm_packs_epi32(left0, left1));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(right + k), _mm_packs_epi32(right0, right1));
+        }
+
+        deinterleaveStereoScalar(frames + 2 * k, left + k, right + k, framesCount - k);
+    }
+
+    void downmixStereoSse2(const qint16 *frames, qint16 *mono, const int framesCount)
+    {
+        auto k = 0;
+        for (; k + 8 <= framesCount; k += 8)
+        {
+            __m128i left0, right0, left1, right1;
+            splitFramesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 2 * k)), left0, right0);
+            splitFramesSse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + 2 * k + 8)), left1, right1);
+
+            // Sums are calculated in 32 bits, so they never overflow
+            const auto mono0 = _mm_srai_epi32(_mm_add_epi32(left0, right0), 1);
+            const auto mono1 = _mm_srai_epi32(_mm_add_epi32(left1, right1), 1);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(mono + k), _mm_packs_epi32(mono0, mono1));
+        }
+
+        downmixStereoScalar(frames + 2 * k, mono + k, framesCount - k);
+    }
+
+    // AVX2, double precision: two complex values per register
+
+    TARGET_AVX2 inline __m256d multiplyComplexAvx2(const __m256d a, const __m256d b)
+    {
+        const auto bReal = _mm256_movedup_pd(b);
+        const auto bImag = _mm256_permute_pd(b, 0xF);
+        const auto aSwapped = _mm256_permute_pd(a, 0x5);
+
+        // (ar * br - ai * bi, ai * br + ar * bi)
+        return _mm256_addsub_pd(_mm256_mul_pd(a, bReal), _mm256_mul_pd(aSwapped, bImag));
+    }
+
+    TARGET_AVX2 void butterflyAvx2(complex *even, complex *odd, const complex *twiddles, const int count)
+    {
+        const auto evenData = reinterpret_cast<double *>(even);
+        const auto oddData = reinterpret_cast<double *>(odd);
+        const auto twiddlesData = reinterpret_cast<const double *>(twiddles);
+
+        auto k = 0;
+        for (; k + 2 <= count; k += 2)
+        {
+            const auto e = _mm256_loadu_pd(evenData + 2 * k);
+            const auto t = multiplyComplexAvx2(_mm256_loadu_pd(oddData + 2 * k), _mm256_loadu_pd(twiddlesData + 2 * k));
+
+            _mm256_storeu_pd(oddData + 2 * k, _mm256_sub_pd(e, t));
+            _mm256_storeu_pd(evenData + 2 * k, _mm256_add_pd(e, t));
+        }
+
+        butterflySse2(even + k, odd + k, twiddles + k, count - k);
+    }
+
+    TARGET_AVX2 void magnitudeAvx2(const complex *spectra, float *magnitudes, const int count)
+    {
+        const auto data = reinterpret_cast<const double *>(spectra);
+
+        auto k = 0;
+        for (; k + 4 <= count; k += 4)
+        {
+            const auto v0 = _mm256_loadu_pd(data + 2 * k);
+            const auto v1 = _mm256_loadu_pd(data + 2 * k + 4);
+
+            // (|s0|^2, |s2|^2, |s1|^2, |s3|^2) reordered to (|s0|^2, |s1|^2, |s2|^2, |s3|^2)
+            const auto sums = _mm256_hadd_pd(_mm256_mul_pd(v0, v0), _mm256_mul_pd(v1, v1));
+            const auto ordered = _mm256_permute4x64_pd(sums, 0xD8);
+
+            _mm_storeu_ps(magnitudes + k, _mm256_cvtpd_ps(_mm256_sqrt_pd(ordered)));
+        }
+
+        magnitudeSse2(spectra + k, magnitudes + k, count - k);
+    }
+
+    TARGET_AVX2 void int16ToDoubleAvx2(const qint16 *samples, double *values, const int count)
+    {
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + k));
+            const auto integers = _mm256_cvtepi16_epi32(v);
+
+            _mm256_storeu_pd(values + k, _mm256_cvtepi32_pd(_mm256_castsi256_si128(integers)));
+            _mm256_storeu_pd(values + k + 4, _mm256_cvtepi32_pd(_mm256_extracti128_si256(integers, 1)));
+        }
+
+        int16ToRealScalar<double>(samples + k, values + k, count - k);
+    }
+
+    TARGET_AVX2 void int16ToComplexAvx2(const qint16 *samples, complex *values, const int count)
+    {
+        const auto data = reinterpret_cast<double *>(values);
+        const auto zero = _mm256_setzero_pd();
+
+        auto k = 0;
+        for (; k + 4 <= count; k += 4)
+        {
+            const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(samples + k));
+
+            // (s0, s1, s2, s3) -> (s0, 0, s1, 0) and (s2, 0, s3, 0)
+            const auto doubles = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(v));
+            const auto low = _mm256_unpacklo_pd(doubles, zero);
+            const auto high = _mm256_unpackhi_pd(doubles, zero);
+
+            _mm256_storeu_pd(data + 2 * k, _mm256_permute2f128_pd(low, high, 0x20));
+            _mm256_storeu_pd(data + 2 * k + 4, _mm256_permute2f128_pd(low, high, 0x31));
+        }
+
+        int16ToComplexScalar<double>(samples + k, values + k, count - k);
+    }
+
+    // AVX2, single precision: four complex values per register
+
+    TARGET_AVX2 inline __m256 multiplyComplexFloatAvx2(const __m256 a, const __m256 b)
+    {
+        const auto bReal = _mm256_moveldup_ps(b);
+        const auto bImag = _mm256_movehdup_ps(b);
+        const auto aSwapped = _mm256_permute_ps(a, 0xB1);
+
+        return _mm256_addsub_ps(_mm256_mul_ps(a, bReal), _mm256_mul_ps(aSwapped, bImag));
+    }
+
+    TARGET_AVX2 void butterflyFloatAvx2(complexf *even, complexf *odd, const complexf *twiddles, const int count)
+    {
+        const auto evenData = reinterpret_cast<float *>(even);
+        const auto oddData = reinterpret_cast<float *>(odd);
+        const auto twiddlesData = reinterpret_cast<const float *>(twiddles);
+
+        auto k = 0;
+        for (; k + 4 <= count; k += 4)
+        {
+            const auto e = _mm256_loadu_ps(evenData + 2 * k);
+            const auto t = multiplyComplexFloatAvx2(_mm256_loadu_ps(oddData + 2 * k), _mm256_loadu_ps(twiddlesData + 2 * k));
+
+            _mm256_storeu_ps(oddData + 2 * k, _mm256_sub_ps(e, t));
+            _mm256_storeu_ps(evenData + 2 * k, _mm256_add_ps(e, t));
+        }
+
+        butterflyFloatSse2(even + k, odd + k, twiddles + k, count - k);
+    }
+
+    TARGET_AVX2 void magnitudeFloatAvx2(const complexf *spectra, float *magnitudes, const int count)
+    {
+        const auto data = reinterpret_cast<const float *>(spectra);
+
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            const auto v0 = _mm256_loadu_ps(data + 2 * k);
+            const auto v1 = _mm256_loadu_ps(data + 2 * k + 8);
+            const auto squares0 = _mm256_mul_ps(v0, v0);
+            const auto squares1 = _mm256_mul_ps(v1, v1);
+
+            // Shuffles work within 128-bit lanes, so the 64-bit quarters are put back in order afterwards
+            const auto reals = _mm256_shuffle_ps(squares0, squares1, 0x88);
+            const auto imags = _mm256_shuffle_ps(squares0, squares1, 0xDD);
+            const auto sums = _mm256_castps_pd(_mm256_add_ps(reals, imags));
+            const auto ordered = _mm256_castpd_ps(_mm256_permute4x64_pd(sums, 0xD8));
+
+            _mm256_storeu_ps(magnitudes + k, _mm256_sqrt_ps(ordered));
+        }
+
+        magnitudeFloatSse2(spectra + k, magnitudes + k, count - k);
+    }
+
+    TARGET_AVX2 void int16ToFloatAvx2(const qint16 *samples, float *values, const int count)
+    {
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + k));
+
+            _mm256_storeu_ps(values + k, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)));
+        }
+
+        int16ToRealScalar<float>(samples + k, values + k, count - k);
+    }
+
+    TARGET_AVX2 void int16ToComplexFloatAvx2(const qint16 *samples, complexf *values, const int count)
+    {
+        const auto data = reinterpret_cast<float *>(values);
+        const auto zero = _mm256_setzero_ps();
+
+        auto k = 0;
+        for (; k + 8 <= count; k += 8)
+        {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + k));
+            const auto floats = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+
+            // (s0, 0, s1, 0 | s4, 0, s5, 0) and (s2, 0, s3, 0 | s6, 0, s7, 0)
+            const auto low = _mm256_unpacklo_ps(floats, zero);
+            const auto high = _mm256_unpackhi_ps(floats, zero);
+
+            _mm256_storeu_ps(data + 2 * k, _mm256_permute2f128_ps(low, high, 0x20));
+            _mm256_storeu_ps(data + 2 * k + 8, _mm256_permute2f128_ps(low, high, 0x31));
+        }
+
+        int16ToComplexScalar<float>(samples + k, values + k, count - k);
+    }
+
+    // AVX2, stereo frames: eight frames per register
+
+    TARGET_AVX2 inline void splitFramesAvx2(const __m256i frames, __m256i &left, __m256i &right)
+    {
+        left = _mm256_srai_epi32(_mm256_slli_epi32(frames, 16), 16);
+        right = _mm256_srai_epi32(frames, 16);
+    }
+
+    // Packing works within 128-bit lanes, so the 64-bit quarters are put back in order afterwards
+    TARGET_AVX2 inline __m256i packInt32Avx2(const __m256i low, const __m256i high)
+    {
+        return _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+    }
+
+    TARGET_AVX2 void deinterleaveStereoAvx2(const qint16 *frames, qint16 *left, qint16 *right, const int framesCount)
+    {
+        auto k = 0;
+        for (; k + 16 <= framesCount; k += 16)
+        {
+            __m256i left0, right0, left1, right1;
+            splitFramesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(frames + 2 * k)), left0, right0);
+            splitFramesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(frames + 2 * k + 16)), left1, right1);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(left + k), packInt32Avx2(left0, left1));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(right + k), packInt32Avx2(right0, right1));
+        }
+
+        deinterleaveStereoSse2(frames + 2 * k, left + k, right + k, framesCount - k);
+    }
+
+    TARGET_AVX2 void downmixStereoAvx2(const qint16 *frames, qint16 *mono, const int framesCount)
+    {
+        auto k = 0;
+        for (; k + 16 <= framesCount; k += 16)
+        {
+            __m256i left0, right0, left1, right1;
+            splitFramesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(frames + 2 * k)), left0, right0);
+            splitFramesAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(frames + 2 * k + 16)), left1, right1);
+
+            const auto mono0 = _mm256_srai_epi32(_mm256_add_epi32(left0, right0), 1);
+            const auto mono1 = _mm256_srai_epi32(_mm256_add_epi32(left1, right1), 1);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(mono + k), packInt32Avx2(mono0, mono1));
+        }
+
+        downmixStereoSse2(frames + 2 * k, mono + k, framesCount - k);
+    }
+
+    bool cpuSupportsAvx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // AVX has to be enabled by the OS as well, which is reported by OSXSAVE and XCR0
+        __cpuid(info, 1);
+        const auto osUsesXsave = (info[2] & (1 << 27)) != 0;
+        const auto cpuSupportsAvx = (info[2] & (1 << 28)) != 0;
+        if (!osUsesXsave || !cpuSupportsAvx || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+#endif
+
+    const SimdKernels SCALAR_KERNELS = {
+        SimdKernels::Scalar,
+        { butterflyScalar<double>, magnitudeScalar<double>, int16ToRealScalar<double>, int16ToComplexScalar<double> },
+        { butterflyScalar<float>, magnitudeScalar<float>, int16ToRealScalar<float>, int16ToComplexScalar<float> },
+        deinterleaveStereoScalar,
+        downmixStereoScalar
+    };
+
+#ifdef SIMD_KERNELS_X86
+    const SimdKernels SSE2_KERNELS = {
+        SimdKernels::Sse2,
+        { butterflySse2, magnitudeSse2, int16ToDoubleSse2, int16ToComplexSse2 },
+        { butterflyFloatSse2, magnitudeFloatSse2, int16ToFloatSse2, int16ToComplexFloatSse2 },
+        deinterleaveStereoSse2,
+        downmixStereoSse2
+    };
+
+    const SimdKernels AVX2_KERNELS = {
+        SimdKernels::Avx2,
+        { butterflyAvx2, magnitudeAvx2, int16ToDoubleAvx2, int16ToComplexAvx2 },
+        { butterflyFloatAvx2, magnitudeFloatAvx2, int16ToFloatAvx2, int16ToComplexFloatAvx2 },
+        deinterleaveStereoAvx2,
+        downmixStereoAvx2
+    };
+#endif
+}
+
+const SimdKernels &SimdKernels::best()
+{
+    static const SimdKernels &kernels = []() -> const SimdKernels & {
+        for (auto instructionSet : { Avx2, Sse2 })
+        {
+            const auto supported = forInstructionSet(instructionSet);
+            if (supported != nullptr)
+            {
+                return *supported;
+            }
+        }
+
+        return SCALAR_KERNELS;
+    }();
+
+    return kernels;
+}
+
+const SimdKernels *SimdKernels::forInstructionSet(const InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case Scalar:
+        return &SCALAR_KERNELS;
+#ifdef SIMD_KERNELS_X86
+    case Sse2:
+        return &SSE2_KERNELS;
+    case Avx2:
+        return cpuSupportsAvx2() ? &AVX2_KERNELS : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const char *SimdKernels::instructionSetName(const InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+    case Sse2:
+        return "SSE2";
+    case Avx2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QtGlobal>
+#include <complex>
+
+typedef std::complex<double> complex;
+typedef std::complex<float> complexf;
+
+// Hot loops of the spectrum analysis for one floating point precision
+template<typename T>
+struct SimdKernelTable
+{
+    typedef std::complex<T> Complex;
+
+    // t = odd[k] * twiddles[k]; odd[k] = even[k] - t; even[k] = even[k] + t
+    void (*butterfly)(Complex *even, Complex *odd, const Complex *twiddles, int count);
+
+    // magnitudes[k] = sqrt(re^2 + im^2) of spectra[k]
+    void (*magnitude)(const Complex *spectra, float *magnitudes, int count);
+
+    // values[k] = samples[k]
+    void (*int16ToReal)(const qint16 *samples, T *values, int count);
+
+    // values[k] = (samples[k], 0)
+    void (*int16ToComplex)(const qint16 *samples, Complex *values, int count);
+};
+
+// Hot loops of the decoding and the spectrum analysis implemented for several instruction sets.
+// The scalar implementation is the reference one; vectorized implementations
+// are selected at runtime depending on what the CPU supports.
+struct SimdKernels
+{
+    enum InstructionSet
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    InstructionSet instructionSet;
+    SimdKernelTable<double> doublePrecision;
+    SimdKernelTable<float> singlePrecision;
+
+    // left[k] = frames[2k]; right[k] = frames[2k + 1]
+    void (*deinterleaveStereo)(const qint16 *frames, qint16 *left, qint16 *right, int framesCount);
+
+    // mono[k] = (frames[2k] + frames[2k + 1]) >> 1
+    void (*downmixStereo)(const qint16 *frames, qint16 *mono, int framesCount);
+
+    template<typename T>
+    const SimdKernelTable<T> &forType() const;
+
+    // The fastest kernels supported by the CPU, detected once
+    static const SimdKernels &best();
+
+    // Kernels for the given instruction set, or nullptr if the build or the CPU does not support it
+    static const SimdKernels *forInstructionSet(InstructionSet instructionSet);
+
+    static const char *instructionSetName(InstructionSet instructionSet);
+};
+
+template<>
+inline const SimdKernelTable<double> &SimdKernels::forType<double>() const
+{
+    return doublePrecision;
+}
+
+template<>
+inline const SimdKernelTable<float> &SimdKernels::forType<float>() const
+{
+    return singlePrecision;
+}
@@ -0,0 +1,57 @@
+#include "spectrogram.h"
+
+Spectrogram::Spectrogram()
+    : _framesCount(0),
+      _bandsCount(0)
+{
+}
+
+Spectrogram::Spectrogram(const int framesCount, const int bandsCount)
+    : _framesCount(framesCount),
+      _bandsCount(bandsCount),
+      _energies(framesCount * bandsCount)
+{
+}
+
+Spectrogram::Spectrogram(Spectrogram &&other)
+    : _framesCount(other._framesCount),
+      _bandsCount(other._bandsCount),
+      _sampleRate(other._sampleRate),
+      _samplesPerFragment(other._samplesPerFragment),
+      _hopSize(other._hopSize),
+      _energies(std::move(other._energies))
+{
+    other._framesCount = 0;
+    other._bandsCount = 0;
+}
+
+Spectrogram &Spectrogram::operator=(Spectrogram &&other)
+{
+    _framesCount = other._framesCount;
+    _bandsCount = other._bandsCount;
+    _sampleRate = other._sampleRate;
+    _samplesPerFragment = other._samplesPerFragment;
+    _hopSize = other._hopSize;
+    _energies = std::move(other._energies);
+
+    other._framesCount = 0;
+    other._bandsCount = 0;
+
+    return *this;
+}
+
+void Spectrogram::setFraming(const quint32 sampleRate, const int samplesPerFragment, const int hopSize)
+{
+    _sampleRate = sampleRate;
+    _samplesPerFragment = samplesPerFragment;
+    _hopSize = hopSize;
+}
+
+void Spectrogram::appendRow(const quint16 *energySpectrum)
+{
+    // Capacity grows geometrically, so appending rows one by one stays linear
+    _energies.resize((_framesCount + 1) * _bandsCount);
+    memcpy(row(_framesCount), energySpectrum, _bandsCount * sizeof(quint16));
+
+    _framesCount++;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QVector>
+
+// Energy spectra of consecutive fragments stored row by row in a single block:
+// a row per fragment and a column per energy band.
+// Spectrograms are large, so they can be moved but not copied.
+class Spectrogram final
+{
+public:
+    Spectrogram();
+    Spectrogram(int framesCount, int bandsCount);
+    Spectrogram(Spectrogram &&other);
+    Spectrogram &operator=(Spectrogram &&other);
+    Spectrogram(const Spectrogram &) = delete;
+    Spectrogram &operator=(const Spectrogram &) = delete;
+
+    int framesCount() const { return _framesCount; }
+    int bandsCount() const { return _bandsCount; }
+    bool isEmpty() const { return _framesCount == 0; }
+
+    // Fragments of samplesPerFragment samples start every hopSize samples of audio sampled at sampleRate
+    quint32 sampleRate() const { return _sampleRate; }
+    int samplesPerFragment() const { return _samplesPerFragment; }
+    int hopSize() const { return _hopSize; }
+    void setFraming(quint32 sampleRate, int samplesPerFragment, int hopSize);
+
+    // Energy spectrum of the fragment, bandsCount() values long
+    quint16 *row(const int frame) { return _energies.data() + static_cast<qint64>(frame) * _bandsCount; }
+    const quint16 *row(const int frame) const { return _energies.constData() + static_cast<qint64>(frame) * _bandsCount; }
+
+    const quint16 *constData() const { return _energies.constData(); }
+
+    // Adds a fragment after the last one, for spectrograms calculated while the audio arrives.
+    // energySpectrum has to be bandsCount() values long
+    void appendRow(const quint16 *energySpectrum);
+
+private:
+    int _framesCount;
+    int _bandsCount;
+    quint32 _sampleRate = 0;
+    int _samplesPerFragment = 0;
+    int _hopSize = 0;
+    QVector<quint16> _energies;
+};
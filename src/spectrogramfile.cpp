@@ -0,0 +1,199 @@
+#include "spectrogramfile.h"
+
+#include <QSaveFile>
+#include "pipelinestats.h"
+
+// "VSPG" when read in the byte order of the host that wrote the file
+static const quint32 SPECTROGRAM_FILE_MAGIC = 0x47505356;
+
+// 32 bytes, so the payload that follows stays aligned
+struct SpectrogramFile::Header
+{
+    quint32     magic;
+    quint16     version;
+    quint16     payloadType;
+    quint32     sampleRate;
+    quint32     samplesPerFragment;
+    quint32     hopSize;
+    quint32     framesCount;
+    quint32     bandsCount;
+    quint32     reserved;
+};
+
+const quint16 SpectrogramFile::VERSION = 1;
+
+SpectrogramFile::SpectrogramFile(const QString &filePath)
+    : _file(filePath)
+{
+}
+
+SpectrogramFile::~SpectrogramFile()
+{
+    close();
+}
+
+bool SpectrogramFile::open()
+{
+    close();
+
+    if (!_file.open(QIODevice::ReadOnly) || _file.size() < static_cast<qint64>(sizeof(Header)))
+    {
+        close();
+        return false;
+    }
+
+    _mappedData = _file.map(0, _file.size());
+    if (_mappedData == nullptr)
+    {
+        close();
+        return false;
+    }
+
+    const auto fileHeader = header();
+    const qint64 payloadSize = static_cast<qint64>(fileHeader->framesCount) * fileHeader->bandsCount * sizeof(quint16);
+
+    if (fileHeader->magic != SPECTROGRAM_FILE_MAGIC
+        || fileHeader->version != VERSION
+        || fileHeader->payloadType != EnergySpectrogram
+        || _file.size() != static_cast<qint64>(sizeof(Header)) + payloadSize)
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void SpectrogramFile::close()
+{
+    if (_mappedData != nullptr)
+    {
+        _file.unmap(_mappedData);
+        _mappedData = nullptr;
+    }
+
+    _file.close();
+}
+
+const SpectrogramFile::Header *SpectrogramFile::header() const
+{
+    return reinterpret_cast<const Header *>(_mappedData);
+}
+
+SpectrogramFile::PayloadType SpectrogramFile::payloadType() const
+{
+    return static_cast<PayloadType>(header()->payloadType);
+}
+
+quint32 SpectrogramFile::sampleRate() const
+{
+    return header()->sampleRate;
+}
+
+int SpectrogramFile::samplesPerFragment() const
+{
+    return static_cast<int>(header()->samplesPerFragment);
+}
+
+int SpectrogramFile::hopSize() const
+{
+    return static_cast<int>(header()->hopSize);
+}
+
+int SpectrogramFile::framesCount() const
+{
+    return static_cast<int>(header()->framesCount);
+}
+
+int SpectrogramFile::bandsCount() const
+{
+    return static_cast<int>(header()->bandsCount);
+}
+
+const quint16 *SpectrogramFile::row(const int frame) const
+{
+    const auto payload = reinterpret_cast<const quint16 *>(_mappedData + sizeof(Header));
+
+    return payload + static_cast<qint64>(frame) * bandsCount();
+}
+
+Spectrogram SpectrogramFile::toSpectrogram() const
+{
+    Spectrogram spectrogram(framesCount(), bandsCount());
+    spectrogram.setFraming(sampleRate(), samplesPerFragment(), hopSize());
+
+    if (!spectrogram.isEmpty())
+    {
+        memcpy(spectrogram.row(0), row(0), static_cast<size_t>(framesCount()) * bandsCount() * sizeof(quint16));
+    }
+
+    return spectrogram;
+}
+
+bool SpectrogramFile::write(const QString &filePath, const Spectrogram &spectrogram)
+{
+    const Header fileHeader{
+        SPECTROGRAM_FILE_MAGIC,
+        VERSION,
+        EnergySpectrogram,
+        spectrogram.sampleRate(),
+        static_cast<quint32>(spectrogram.samplesPerFragment()),
+        static_cast<quint32>(spectrogram.hopSize()),
+        static_cast<quint32>(spectrogram.framesCount()),
+        static_cast<quint32>(spectrogram.bandsCount()),
+        0
+    };
+    const qint64 payloadSize = static_cast<qint64>(spectrogram.framesCount()) * spectrogram.bandsCount() * sizeof(quint16);
+
+    // The file appears at once or not at all, so readers never map a partially written one
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    if (file.write(reinterpret_cast<const char *>(&fileHeader), sizeof(Header)) != sizeof(Header)
+        || file.write(reinterpret_cast<const char *>(spectrogram.constData()), payloadSize) != payloadSize)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+bool SpectrogramFile::exportCsv(const QString &filePath, const Spectrogram &spectrogram)
+{
+    PipelineStats::StageTimer stageTimer(PipelineStats::CsvExport);
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+
+    const auto bandsCount = spectrogram.bandsCount();
+
+    QByteArray line;
+    for (auto frame = 0; frame < spectrogram.framesCount(); frame++)
+    {
+        const auto spectrum = spectrogram.row(frame);
+
+        line.clear();
+        for (auto band = 0; band < bandsCount; band++)
+        {
+            line.append(QByteArray::number(spectrum[band]));
+            line.append(band != bandsCount - 1 ? ", " : "\n");
+        }
+
+        if (file.write(line) != line.size())
+        {
+            return false;
+        }
+
+        stageTimer.addBytes(line.size());
+        stageTimer.addFrames(1);
+    }
+
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QFile>
+#include "spectrogram.h"
+
+// Binary file of a spectrogram: a fixed-size header followed by the energies of all fragments row by row,
+// exactly as Spectrogram keeps them in memory. Files are written in a single pass and read through
+// a memory mapping, so rows are accessed straight from the page cache without being copied.
+// Values are stored in the byte order of the host that wrote the file, which the magic number reveals,
+// and files of another byte order or version are not opened.
+class SpectrogramFile final
+{
+public:
+    enum PayloadType
+    {
+        // quint16 energies, bandsCount per fragment
+        EnergySpectrogram = 1
+    };
+
+    static const quint16 VERSION;
+
+    explicit SpectrogramFile(const QString &filePath);
+    ~SpectrogramFile();
+    SpectrogramFile(const SpectrogramFile &) = delete;
+    SpectrogramFile &operator=(const SpectrogramFile &) = delete;
+
+    // Maps the file. Returns false if it does not exist, is damaged, or has another version or byte order
+    bool open();
+    void close();
+    bool isOpen() const { return _mappedData != nullptr; }
+
+    PayloadType payloadType() const;
+    quint32 sampleRate() const;
+    int samplesPerFragment() const;
+    int hopSize() const;
+    int framesCount() const;
+    int bandsCount() const;
+
+    // Energy spectrum of the fragment, bandsCount() values long, valid while the file is open
+    const quint16 *row(int frame) const;
+
+    Spectrogram toSpectrogram() const;
+
+    static bool write(const QString &filePath, const Spectrogram &spectrogram);
+
+    // Writes the energies as comma separated values, a row per fragment, for inspection in other tools
+    static bool exportCsv(const QString &filePath, const Spectrogram &spectrogram);
+
+private:
+    struct Header;
+
+    QFile _file;
+    uchar *_mappedData = nullptr;
+
+    const Header *header() const;
+};
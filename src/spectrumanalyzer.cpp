@@ -1,154 +1,318 @@
 #include "spectrumanalyzer.h"
-#include <complex>
+#include "pipelinestats.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <QScopedPointer>
 #include <qmath.h>
-#include <valarray>
 #include <qvector.h>
+#include <algorithm>
+
+template<>
+QMultiHash<FftPlanKey, FftPlan<double> *> &SpectrumAnalyzer::idleFftPlans<double>() const
+{
+    return _doubleFftPlans;
+}
+
+template<>
+QMultiHash<FftPlanKey, FftPlan<float> *> &SpectrumAnalyzer::idleFftPlans<float>() const
+{
+    return _floatFftPlans;
+}
 
 SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent)
     : QObject(parent)
 {
+    _threadPool = new QThreadPool(this);
+    setWorkerCount(QThread::idealThreadCount());
 }
 
 SpectrumAnalyzer::~SpectrumAnalyzer()
 {
+    _threadPool->waitForDone();
+
+    qDeleteAll(_doubleFftPlans);
+    qDeleteAll(_floatFftPlans);
+}
+
+void SpectrumAnalyzer::setWorkerCount(const int workerCount)
+{
+    _workerCount = qMax(1, workerCount);
+
+    // The calling thread computes a part of the spectrogram too
+    _threadPool->setMaxThreadCount(qMax(1, _workerCount - 1));
 }
 
-// TODO: add samplesPerFragment parameter instead of fragmentDurationMs
-const spectrogram *SpectrumAnalyzer::getFrequencySpectrogram(
+Spectrogram SpectrumAnalyzer::getFrequencySpectrogram(
     const QVector<qint16> *pcmAudioData,
     const quint32 sampleRate,
     const quint32 fragmentDurationMs) const
 {
-    const quint32 samplesPerFragment = static_cast<double>(sampleRate) * fragmentDurationMs / 1000;
-    const auto fragmentsByTime = splitByTimeIntervals(pcmAudioData, samplesPerFragment);
-
-    const auto fragmentsCount = fragmentsByTime->count();
-    const auto frequencySpectrogram = new spectrogram(fragmentsCount);
+    const int samplesPerFragment = static_cast<double>(sampleRate) * fragmentDurationMs / 1000;
 
-    for (auto i = 0; i < fragmentsCount; i++)
-    {
-        const auto audioFragment = (*fragmentsByTime)[i];
-        const auto complexRepresentation = toComplex(audioFragment, samplesPerFragment);
+    return getFrequencySpectrogram(pcmAudioData, sampleRate, samplesPerFragment, samplesPerFragment, StftFramer::RectangularWindow);
+}
 
-        fastFourierTransform(*complexRepresentation, samplesPerFragment);
+Spectrogram SpectrumAnalyzer::getFrequencySpectrogram(
+    const QVector<qint16> *pcmAudioData,
+    const quint32 sampleRate,
+    const int samplesPerFragment,
+    const int hopSize,
+    const StftFramer::WindowFunction window) const
+{
+    PipelineStats::StageTimer stageTimer(PipelineStats::SpectrumAnalysis);
 
-        const auto amplitudeSpectrum = toAmplitudeSpectra(*complexRepresentation, samplesPerFragment);
-        const auto energySpectrum = calculateEnergySpectra(amplitudeSpectrum);
+    const StftFramer framer(pcmAudioData->constData(), pcmAudioData->count(), samplesPerFragment, hopSize);
+    stageTimer.addBytes(pcmAudioData->count() * static_cast<qint64>(sizeof(qint16)));
+    stageTimer.addFrames(framer.frameCount());
 
-        (*frequencySpectrogram)[i] = energySpectrum;
+    Spectrogram frequencySpectrogram(framer.frameCount(), ENERGY_SPECTRA_SIZE);
+    frequencySpectrogram.setFraming(sampleRate, samplesPerFragment, hopSize);
 
-        delete amplitudeSpectrum;
-        delete complexRepresentation;
+    if (_precision == SinglePrecision)
+    {
+        calculateSpectrogram<float>(framer, sampleRate, window, &frequencySpectrogram);
+    }
+    else
+    {
+        calculateSpectrogram<double>(framer, sampleRate, window, &frequencySpectrogram);
     }
 
     return frequencySpectrogram;
 }
 
-const QVector<const qint16 *> *SpectrumAnalyzer::splitByTimeIntervals(
-    const QVector<qint16> *pcmAudioData,
-    const quint32 samplesPerFragment) const
+void SpectrumAnalyzer::getEnergySpectrum(
+    const qint16 *samples,
+    const int availableSamples,
+    const quint32 sampleRate,
+    const int samplesPerFragment,
+    const StftFramer::WindowFunction window,
+    quint16 *energySpectrum) const
+{
+    getEnergySpectrum(acquireFragmentPlan(sampleRate, samplesPerFragment, window), samples, availableSamples, energySpectrum);
+}
+
+SpectrumAnalyzer::FragmentPlan SpectrumAnalyzer::acquireFragmentPlan(
+    const quint32 sampleRate,
+    const int samplesPerFragment,
+    const StftFramer::WindowFunction window) const
 {
-    const auto samplesCount = pcmAudioData->count();
-    const int fragmentsCount = ceil(static_cast<double>(samplesCount) / samplesPerFragment);
+    FragmentPlan fragmentPlan;
 
-    const auto result = new QVector<const qint16*>(fragmentsCount);
+    if (_precision == SinglePrecision)
+    {
+        fragmentPlan._floatFftPlan = acquireFftPlan<float>(samplesPerFragment, sampleRate, window);
+    }
+    else
+    {
+        fragmentPlan._doubleFftPlan = acquireFftPlan<double>(samplesPerFragment, sampleRate, window);
+    }
 
-    const auto data = pcmAudioData->constData();
+    return fragmentPlan;
+}
 
-    for (auto i = 0; i < fragmentsCount; i++)
+void SpectrumAnalyzer::getEnergySpectrum(
+    const FragmentPlan &fragmentPlan,
+    const qint16 *samples,
+    const int availableSamples,
+    quint16 *energySpectrum) const
+{
+    if (!fragmentPlan._floatFftPlan.isNull())
     {
-        (*result)[i] = &data[i * samplesPerFragment];
+        const auto size = fragmentPlan._floatFftPlan->size();
+        const StftFramer framer(samples, availableSamples, size, size);
+        calculateFragments(fragmentPlan._floatFftPlan.data(), framer, 0, 1, energySpectrum);
     }
+    else
+    {
+        const auto size = fragmentPlan._doubleFftPlan->size();
+        const StftFramer framer(samples, availableSamples, size, size);
+        calculateFragments(fragmentPlan._doubleFftPlan.data(), framer, 0, 1, energySpectrum);
+    }
+}
 
-    // All fragments sizes should be powers of 2 for fast Fourier transformation
-    const auto lastFragmentSize = fragmentsCount * samplesPerFragment - samplesCount;
-    if (lastFragmentSize != 0)
+template<typename T>
+void SpectrumAnalyzer::calculateSpectrogram(
+    const StftFramer &framer,
+    const quint32 sampleRate,
+    const StftFramer::WindowFunction window,
+    Spectrogram *frequencySpectrogram) const
+{
+    const auto fragmentsCount = framer.frameCount();
+    const auto tasksCount = qBound(1, fragmentsCount / MIN_FRAGMENTS_PER_TASK, _workerCount);
+
+    // Every task gets its own plan, so scratch buffers are never shared between threads.
+    // Plans are acquired here rather than in the tasks to report setup errors on the calling thread
+    QVector<QSharedPointer<FftPlan<T>>> fftPlans(tasksCount);
+    for (auto &fftPlan : fftPlans)
     {
-        const auto fullLastFragment = new qint16[samplesPerFragment];
+        fftPlan = acquireFftPlan<T>(framer.frameSize(), sampleRate, window);
+    }
 
-        const auto lastFragment = result->last();
-        const auto missedSamplesCount = samplesPerFragment - lastFragmentSize;
+    // Tasks write into disjoint rows of the preallocated spectrogram,
+    // so the result does not depend on the scheduling
+    QVector<QFuture<void>> tasks;
+    for (auto task = 1; task < tasksCount; task++)
+    {
+        const int begin = static_cast<qint64>(fragmentsCount) * task / tasksCount;
+        const int end = static_cast<qint64>(fragmentsCount) * (task + 1) / tasksCount;
+        const auto fftPlan = fftPlans[task].data();
 
-        // Copy samples from the last fragment to a new full fragment
-        memcpy(fullLastFragment, lastFragment, lastFragmentSize);
+        tasks.append(QtConcurrent::run(_threadPool, [=, &framer]() {
+            calculateFragments(fftPlan, framer, begin, end, frequencySpectrogram->row(begin));
+        }));
+    }
 
-        // Set missed values as 0
-        memset(&fullLastFragment[lastFragmentSize], 0, missedSamplesCount);
+    // The calling thread takes the first range instead of waiting idle
+    const int firstTaskEnd = static_cast<qint64>(fragmentsCount) / tasksCount;
+    calculateFragments(fftPlans[0].data(), framer, 0, firstTaskEnd, frequencySpectrogram->row(0));
 
-        result->removeLast();
-        result->append(fullLastFragment);
+    for (auto &task : tasks)
+    {
+        task.waitForFinished();
     }
+}
+
+template<typename T>
+void SpectrumAnalyzer::calculateFragments(
+    FftPlan<T> *fftPlan,
+    const StftFramer &framer,
+    const int begin,
+    const int end,
+    quint16 *energySpectra)
+{
+    const auto isRealFft = fftPlan->key().realInput;
+    const auto samplesPerFragment = framer.frameSize();
+    const auto &window = fftPlan->window();
+
+    // Plan buffers are shared by all fragments, so the loop below allocates nothing
+    const auto complexRepresentation = fftPlan->complexBuffer();
+    const auto amplitudeSpectrum = fftPlan->amplitudeBuffer();
+
+    for (auto i = begin; i < end; i++)
+    {
+        const auto audioFragment = framer.frame(i);
+
+        if (isRealFft)
+        {
+            toPackedComplex(audioFragment.samples, audioFragment.availableSamples, window, complexRepresentation, samplesPerFragment);
+        }
+        else
+        {
+            toComplex(audioFragment.samples, audioFragment.availableSamples, window, complexRepresentation, samplesPerFragment);
+        }
+
+        fftPlan->transform();
+
+        toAmplitudeSpectra(complexRepresentation, samplesPerFragment, amplitudeSpectrum);
 
-    return result;
+        calculateEnergySpectra(amplitudeSpectrum, energySpectra + static_cast<qint64>(i - begin) * ENERGY_SPECTRA_SIZE);
+    }
 }
 
-complex_array *SpectrumAnalyzer::toComplex(const qint16 *pcmAudioData, const int size)
+template<typename T>
+QSharedPointer<FftPlan<T>> SpectrumAnalyzer::acquireFftPlan(
+    const int size,
+    const quint32 sampleRate,
+    const StftFramer::WindowFunction window) const
 {
-    const auto complexValues = new complex_array(size);
+    const FftPlanKey key{ size, sampleRate, _fftMode == RealFft, window };
+
+    FftPlan<T> *fftPlan = nullptr;
+    {
+        QMutexLocker locker(&_fftPlansMutex);
+        fftPlan = idleFftPlans<T>().take(key);
+    }
 
-    for (auto i = 0; i < size; i++)
+    if (fftPlan == nullptr)
     {
-        (*complexValues)[i] = static_cast<double>(pcmAudioData[i]);
+        fftPlan = new FftPlan<T>(key);
     }
 
-    return complexValues;
+    return QSharedPointer<FftPlan<T>>(fftPlan, [this](FftPlan<T> *plan) { releaseFftPlan(plan); });
 }
 
-void SpectrumAnalyzer::fastFourierTransform(complex_array &spectra, int n) const
+template<typename T>
+void SpectrumAnalyzer::releaseFftPlan(FftPlan<T> *fftPlan) const
 {
-    if (n < 1)
+    QMutexLocker locker(&_fftPlansMutex);
+    idleFftPlans<T>().insert(fftPlan->key(), fftPlan);
+}
+
+template<typename T>
+void SpectrumAnalyzer::toComplex(
+    const qint16 *pcmAudioData,
+    const int availableSamples,
+    const QVector<T> &window,
+    std::complex<T> *complexValues,
+    const int size)
+{
+    SimdKernels::best().forType<T>().int16ToComplex(pcmAudioData, complexValues, availableSamples);
+
+    if (!window.isEmpty())
+    {
+        for (auto i = 0; i < availableSamples; i++)
+        {
+            complexValues[i] *= window[i];
+        }
+    }
+
+    // The last fragment may be incomplete, so it is padded with silence up to the FFT size
+    for (auto i = availableSamples; i < size; i++)
     {
-        return;
+        complexValues[i] = 0;
     }
+}
 
-    n >>= 1;
+template<typename T>
+void SpectrumAnalyzer::toPackedComplex(
+    const qint16 *pcmAudioData,
+    const int availableSamples,
+    const QVector<T> &window,
+    std::complex<T> *complexValues,
+    const int size)
+{
+    // Even samples become real parts and odd samples become imaginary parts,
+    // which is exactly the memory layout of consecutive samples converted to T
+    const auto values = reinterpret_cast<T *>(complexValues);
 
-    complex_array odd = spectra[std::slice(0, n, 2)];
-    complex_array even = spectra[std::slice(1, n, 2)];
+    SimdKernels::best().forType<T>().int16ToReal(pcmAudioData, values, availableSamples);
 
-    fastFourierTransform(even, n);
-    fastFourierTransform(odd, n);
+    if (!window.isEmpty())
+    {
+        const auto coefficients = window.constData();
+        for (auto i = 0; i < availableSamples; i++)
+        {
+            values[i] *= coefficients[i];
+        }
+    }
 
-    for (auto i = 0; i < n; i++)
+    for (auto i = availableSamples; i < size; i++)
     {
-        auto t = exp(std::complex<double>(0, -2 * M_PI * i / (n * 2))) * odd[i];
-        spectra[i] = even[i] + t;
-        spectra[n + i] = even[i] - t;
+        values[i] = 0;
     }
 }
 
-const QVector<float> *SpectrumAnalyzer::toAmplitudeSpectra(complex_array &spectra, int size) const
+template<typename T>
+void SpectrumAnalyzer::toAmplitudeSpectra(const std::complex<T> *spectra, int size, QVector<float> *amplitudeSpectra)
 {
     // According to NyquistShannon sampling theorem,
     // the second half of spectra sequence is a mirror reflection of the first one.
     // So we can use only the half of data for analysis
     size = size >> 1;
 
-    const auto amplitudeSpectra = new QVector<float>(size);
-    for (auto i = 0; i < size; i++)
-    {
-        const auto spectrum = spectra[i];
-        const auto real = spectrum.real();
-        const auto imag = spectrum.imag();
-
-        (*amplitudeSpectra)[i] = sqrt(real * real + imag * imag);
-    }
-
-    return amplitudeSpectra;
+    SimdKernels::best().forType<T>().magnitude(spectra, amplitudeSpectra->data(), size);
 }
 
-const QVector<quint16> *SpectrumAnalyzer::calculateEnergySpectra(const QVector<float> *amplitudeSpectrum)
+void SpectrumAnalyzer::calculateEnergySpectra(const QVector<float> *amplitudeSpectrum, quint16 *energySpectrum)
 {
-    const auto energySpectra = new QVector<quint16>(ENERGY_SPECTRA_SIZE, 0);
+    std::fill(energySpectrum, energySpectrum + ENERGY_SPECTRA_SIZE, 0);
 
     for (auto spectrum : *amplitudeSpectrum)
     {
         if (spectrum < UPPER_ANALYZED_FREQUENCY)
         {
             const quint16 spectrumIntervalIndex = spectrum / FREQUENCY_STEP_HZ;
-            (*energySpectra)[spectrumIntervalIndex]++;
+            energySpectrum[spectrumIntervalIndex]++;
         }
     }
-
-    return energySpectra;
 }
@@ -1,31 +1,127 @@
 #pragma once
 
 #include <QObject>
-#include <complex>
-#include <valarray>
-
-typedef std::complex<double> complex;
-typedef std::valarray<complex> complex_array;
-typedef QVector<const QVector<quint16> *> spectrogram;
+#include <QMutex>
+#include <QMultiHash>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include "fftplan.h"
+#include "spectrogram.h"
 
 class SpectrumAnalyzer : public QObject
 {
     Q_OBJECT
 
 public:
+    enum FftMode
+    {
+        // Samples are widened to complex values and transformed by a full size complex FFT
+        ComplexFft,
+        // Pairs of samples are packed into complex values and transformed by a half size complex FFT
+        RealFft
+    };
+    Q_ENUM(FftMode)
+
+    enum Precision
+    {
+        DoublePrecision,
+        // Enough for 16-bit PCM: halves the memory traffic and doubles the SIMD width
+        SinglePrecision
+    };
+    Q_ENUM(Precision)
+
+    // FFT plan for single fragments of one framing, taken from the idle plans of the analyzer and put back
+    // when the last copy is destroyed. A stream analyzed frame by frame holds one for all its frames
+    // instead of taking a plan for every frame. A plan is used by one thread at a time
+    class FragmentPlan final
+    {
+    public:
+        bool isNull() const { return _floatFftPlan.isNull() && _doubleFftPlan.isNull(); }
+
+    private:
+        friend class SpectrumAnalyzer;
+
+        QSharedPointer<FftPlan<float>> _floatFftPlan;
+        QSharedPointer<FftPlan<double>> _doubleFftPlan;
+    };
+
     explicit SpectrumAnalyzer(QObject *parent);
     ~SpectrumAnalyzer();
 
-    const spectrogram *getFrequencySpectrogram(const QVector<qint16> *pcmAudioData, quint32 sampleRate, quint32 fragmentDurationMs) const;
+    // ComplexFft and DoublePrecision unless set otherwise
+    FftMode fftMode() const { return _fftMode; }
+    void setFftMode(FftMode fftMode) { _fftMode = fftMode; }
+
+    Precision precision() const { return _precision; }
+    void setPrecision(Precision precision) { _precision = precision; }
+
+    // Number of threads computing fragments of a spectrogram in parallel, including the calling one.
+    // 1 computes spectrograms sequentially on the calling thread
+    int workerCount() const { return _workerCount; }
+    void setWorkerCount(int workerCount);
+
+    // Number of energy bands in every spectrum
+    static int energySpectrumSize() { return ENERGY_SPECTRA_SIZE; }
+
+    // Spectrogram of consecutive non-overlapping fragments of fragmentDurationMs, which has to give a power-of-two number of samples
+    Spectrogram getFrequencySpectrogram(const QVector<qint16> *pcmAudioData, quint32 sampleRate, quint32 fragmentDurationMs) const;
+
+    // Spectrogram of windowed fragments of samplesPerFragment (a power of 2) starting every hopSize samples
+    Spectrogram getFrequencySpectrogram(const QVector<qint16> *pcmAudioData, quint32 sampleRate, int samplesPerFragment,
+                                        int hopSize, StftFramer::WindowFunction window = StftFramer::HannWindow) const;
+
+    // Energy spectrum of a single fragment of samplesPerFragment, zero-padded if fewer samples are available.
+    // energySpectrum receives energySpectrumSize() values
+    void getEnergySpectrum(const qint16 *samples, int availableSamples, quint32 sampleRate, int samplesPerFragment,
+                           StftFramer::WindowFunction window, quint16 *energySpectrum) const;
+
+    // Plan of the current precision and FFT mode, which has to outlive neither the analyzer
+    // nor a change of them while it is used
+    FragmentPlan acquireFragmentPlan(quint32 sampleRate, int samplesPerFragment, StftFramer::WindowFunction window) const;
+
+    // Energy spectrum of a single fragment of the plan's size, zero-padded if fewer samples are available
+    void getEnergySpectrum(const FragmentPlan &fragmentPlan, const qint16 *samples, int availableSamples,
+                           quint16 *energySpectrum) const;
 
 private:
     static const int UPPER_ANALYZED_FREQUENCY = 8000;
     static const int FREQUENCY_STEP_HZ = 50;
     static const int ENERGY_SPECTRA_SIZE = UPPER_ANALYZED_FREQUENCY / FREQUENCY_STEP_HZ;
 
-    const QVector<const qint16 *> *splitByTimeIntervals(const QVector<qint16> *pcmAudioData, quint32 samplesPerFragment) const;
-    static complex_array *toComplex(const qint16 *pcmAudioData, int size);
-    void fastFourierTransform(complex_array &spectra, int n) const;
-    const QVector<float> *toAmplitudeSpectra(complex_array &spectra, int size) const;
-    static const QVector<quint16> *calculateEnergySpectra(const QVector<float> *amplitudeSpectrum);
+    // Smaller tasks cost more in scheduling than they gain in parallelism
+    static const int MIN_FRAGMENTS_PER_TASK = 64;
+
+    FftMode _fftMode = ComplexFft;
+    Precision _precision = DoublePrecision;
+    int _workerCount = 1;
+    QThreadPool *_threadPool = nullptr;
+
+    // Idle plans by their parameters. A plan is taken out while a spectrogram is being calculated
+    // and put back afterwards, so concurrent calls never share scratch buffers
+    mutable QMultiHash<FftPlanKey, FftPlan<double> *> _doubleFftPlans;
+    mutable QMultiHash<FftPlanKey, FftPlan<float> *> _floatFftPlans;
+    mutable QMutex _fftPlansMutex;
+
+    template<typename T>
+    void calculateSpectrogram(const StftFramer &framer, quint32 sampleRate, StftFramer::WindowFunction window,
+                              Spectrogram *frequencySpectrogram) const;
+    // Writes energy spectra of fragments [begin, end) one after another starting at energySpectra
+    template<typename T>
+    static void calculateFragments(FftPlan<T> *fftPlan, const StftFramer &framer, int begin, int end,
+                                   quint16 *energySpectra);
+
+    template<typename T>
+    QMultiHash<FftPlanKey, FftPlan<T> *> &idleFftPlans() const;
+    template<typename T>
+    QSharedPointer<FftPlan<T>> acquireFftPlan(int size, quint32 sampleRate, StftFramer::WindowFunction window) const;
+    template<typename T>
+    void releaseFftPlan(FftPlan<T> *fftPlan) const;
+
+    template<typename T>
+    static void toComplex(const qint16 *pcmAudioData, int availableSamples, const QVector<T> &window, std::complex<T> *complexValues, int size);
+    template<typename T>
+    static void toPackedComplex(const qint16 *pcmAudioData, int availableSamples, const QVector<T> &window, std::complex<T> *complexValues, int size);
+    template<typename T>
+    static void toAmplitudeSpectra(const std::complex<T> *spectra, int size, QVector<float> *amplitudeSpectra);
+    static void calculateEnergySpectra(const QVector<float> *amplitudeSpectrum, quint16 *energySpectrum);
 };
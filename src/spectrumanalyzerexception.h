@@ -0,0 +1,8 @@
+#pragma once
+
+#include "baseexception.h"
+
+class SpectrumAnalyzerException : public BaseException
+{
+    using BaseException::BaseException;
+};
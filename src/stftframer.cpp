@@ -0,0 +1,70 @@
+#include "stftframer.h"
+#include "fftengine.h"
+#include "spectrumanalyzerexception.h"
+
+#include <qmath.h>
+
+StftFramer::StftFramer(const qint16 *samples, const qint64 samplesCount, const int frameSize, const int hopSize)
+    : _samples(samples),
+      _samplesCount(samplesCount),
+      _frameSize(frameSize),
+      _hopSize(hopSize)
+{
+    if (!isPowerOfTwo(frameSize))
+    {
+        throw SpectrumAnalyzerException("Samples per fragment should be a power of 2");
+    }
+
+    if (hopSize <= 0 || hopSize > frameSize)
+    {
+        throw SpectrumAnalyzerException("Hop size should be positive and not greater than samples per fragment");
+    }
+
+    _frameCount = frameCount(samplesCount, frameSize, hopSize);
+}
+
+int StftFramer::frameCount(const qint64 samplesCount, const int frameSize, const int hopSize)
+{
+    if (samplesCount <= 0)
+    {
+        return 0;
+    }
+
+    // Frames are added until one of them reaches the end of the samples
+    if (samplesCount <= frameSize)
+    {
+        return 1;
+    }
+
+    return 1 + static_cast<int>((samplesCount - frameSize + hopSize - 1) / hopSize);
+}
+
+StftFrame StftFramer::frame(const int index) const
+{
+    const qint64 start = static_cast<qint64>(index) * _hopSize;
+    const auto availableSamples = static_cast<int>(qMin<qint64>(_frameSize, _samplesCount - start));
+
+    return StftFrame{ _samples + start, availableSamples };
+}
+
+QVector<double> StftFramer::windowCoefficients(const WindowFunction windowFunction, const int size)
+{
+    QVector<double> coefficients;
+
+    if (windowFunction == RectangularWindow)
+    {
+        return coefficients;
+    }
+
+    // Hann: 0.5 - 0.5 * cos(2 * pi * n / N), Hamming: 0.54 - 0.46 * cos(2 * pi * n / N)
+    const auto a0 = windowFunction == HannWindow ? 0.5 : 0.54;
+    const auto a1 = 1 - a0;
+
+    coefficients.resize(size);
+    for (auto n = 0; n < size; n++)
+    {
+        coefficients[n] = a0 - a1 * cos(2 * M_PI * n / size);
+    }
+
+    return coefficients;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QVector>
+
+// A frame of PCM samples. It points into the analyzed buffer rather than holding a copy;
+// the last frames may have less than a frame of samples available and have to be zero-padded.
+struct StftFrame
+{
+    const qint16 *samples;
+    int availableSamples;
+};
+
+// Splits PCM samples into frames of a power-of-two size that start every hopSize samples,
+// so consecutive frames overlap when hopSize is less than the frame size.
+class StftFramer final
+{
+public:
+    enum WindowFunction
+    {
+        RectangularWindow,
+        HannWindow,
+        HammingWindow
+    };
+
+    StftFramer(const qint16 *samples, qint64 samplesCount, int frameSize, int hopSize);
+
+    int frameSize() const { return _frameSize; }
+    int hopSize() const { return _hopSize; }
+    int frameCount() const { return _frameCount; }
+
+    StftFrame frame(int index) const;
+
+    static int frameCount(qint64 samplesCount, int frameSize, int hopSize);
+
+    // Periodic window coefficients of the given size, empty for the rectangular window
+    static QVector<double> windowCoefficients(WindowFunction windowFunction, int size);
+
+private:
+    const qint16 *_samples;
+    qint64 _samplesCount;
+    int _frameSize;
+    int _hopSize;
+    int _frameCount;
+};
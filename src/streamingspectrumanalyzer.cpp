@@ -0,0 +1,81 @@
+#include "streamingspectrumanalyzer.h"
+#include "spectrumanalyzerexception.h"
+
+StreamingSpectrumAnalyzer::StreamingSpectrumAnalyzer(
+    const SpectrumAnalyzer *spectrumAnalyzer,
+    const quint32 sampleRate,
+    const int samplesPerFragment,
+    const int hopSize,
+    const StftFramer::WindowFunction window,
+    QObject *parent)
+    : QObject(parent),
+      _spectrumAnalyzer(spectrumAnalyzer),
+      _samplesPerFragment(samplesPerFragment),
+      _hopSize(hopSize)
+{
+    // Validates the parameters the same way the batch analysis does
+    StftFramer(nullptr, 0, samplesPerFragment, hopSize);
+
+    _fragmentPlan = spectrumAnalyzer->acquireFragmentPlan(sampleRate, samplesPerFragment, window);
+
+    _pendingSamples.reserve(samplesPerFragment);
+    _energySpectrum.resize(SpectrumAnalyzer::energySpectrumSize());
+}
+
+StreamingSpectrumAnalyzer::~StreamingSpectrumAnalyzer()
+{
+}
+
+void StreamingSpectrumAnalyzer::process(const qint16 *samples, const int count)
+{
+    auto processed = 0;
+
+    while (processed < count)
+    {
+        const auto missingSamples = _samplesPerFragment - _pendingSamples.count();
+        const auto copiedSamples = qMin(missingSamples, count - processed);
+
+        const auto pendingCount = _pendingSamples.count();
+        _pendingSamples.resize(pendingCount + copiedSamples);
+        memcpy(_pendingSamples.data() + pendingCount, samples + processed, copiedSamples * sizeof(qint16));
+
+        processed += copiedSamples;
+
+        if (_pendingSamples.count() == _samplesPerFragment)
+        {
+            analyzePendingFrame();
+
+            // The overlap with the next frame is all the state kept
+            _pendingSamples.remove(0, _hopSize);
+        }
+    }
+}
+
+void StreamingSpectrumAnalyzer::finish()
+{
+    // The batch analysis adds frames until one of them reaches the end of the track,
+    // which leaves one incomplete frame at most unless the last complete frame ended exactly there
+    const auto hasIncompleteFrame = _framesCount == 0
+        ? !_pendingSamples.isEmpty()
+        : _pendingSamples.count() > _samplesPerFragment - _hopSize;
+
+    if (hasIncompleteFrame)
+    {
+        analyzePendingFrame();
+    }
+
+    const auto framesCount = _framesCount;
+
+    _pendingSamples.clear();
+    _framesCount = 0;
+
+    emit finished(framesCount);
+}
+
+void StreamingSpectrumAnalyzer::analyzePendingFrame()
+{
+    _spectrumAnalyzer->getEnergySpectrum(_fragmentPlan, _pendingSamples.constData(), _pendingSamples.count(),
+                                         _energySpectrum.data());
+
+    emit energySpectrumReady(_framesCount++, _energySpectrum);
+}
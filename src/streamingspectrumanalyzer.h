@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QObject>
+#include "spectrumanalyzer.h"
+
+// Calculates energy spectra of PCM audio pushed block by block, e.g. while it is being decoded.
+// Only the samples of a single pending frame are kept between blocks, so memory use does not
+// depend on the track length. Frames are the same as SpectrumAnalyzer::getFrequencySpectrogram
+// produces for the whole track with the same parameters, with the precision and FFT mode the spectrum analyzer
+// has when the streaming one is constructed.
+class StreamingSpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    StreamingSpectrumAnalyzer(const SpectrumAnalyzer *spectrumAnalyzer, quint32 sampleRate, int samplesPerFragment,
+                              int hopSize, StftFramer::WindowFunction window = StftFramer::HannWindow,
+                              QObject *parent = nullptr);
+    ~StreamingSpectrumAnalyzer();
+
+    qint64 framesCount() const { return _framesCount; }
+
+    // Analyzes every frame completed by the block
+    void process(const qint16 *samples, int count);
+
+    // Analyzes the zero-padded last frame and resets the analyzer for the next stream
+    void finish();
+
+signals:
+    void energySpectrumReady(qint64 frameIndex, const QVector<quint16> &energySpectrum);
+    void finished(qint64 framesCount);
+
+private:
+    const SpectrumAnalyzer *_spectrumAnalyzer = nullptr;
+    int _samplesPerFragment;
+    int _hopSize;
+    // Taken once for all frames of the stream
+    SpectrumAnalyzer::FragmentPlan _fragmentPlan;
+
+    // Samples from the start of the next frame, never more than one frame
+    QVector<qint16> _pendingSamples;
+    QVector<quint16> _energySpectrum;
+    qint64 _framesCount = 0;
+
+    void analyzePendingFrame();
+};
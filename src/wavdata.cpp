@@ -8,6 +8,14 @@ WavData::WavData(QObject *parent)
     _audioBuffer = new QByteArray();
 }
 
+WavData::~WavData()
+{
+    unmapAudioBuffer();
+
+    delete _audioBuffer;
+    delete _audioFormat;
+}
+
 QAudioFormat *WavData::audioFormat() const
 {
     return _audioFormat;
@@ -27,3 +35,42 @@ void WavData::setAudioBuffer(QByteArray *audioData)
 {
     _audioBuffer = audioData;
 }
+
+bool WavData::mapAudioBuffer(const QString &filePath, const qint64 offset, const int size)
+{
+    unmapAudioBuffer();
+
+    _mappedFile = new QFile(filePath);
+
+    if (_mappedFile->open(QIODevice::ReadOnly)) {
+        _mappedData = _mappedFile->map(offset, size);
+    }
+
+    if (_mappedData == nullptr) {
+        unmapAudioBuffer();
+        return false;
+    }
+
+    // Modifying the buffer would detach it from the read-only mapping into a copy
+    *_audioBuffer = QByteArray::fromRawData(reinterpret_cast<const char *>(_mappedData), size);
+
+    return true;
+}
+
+void WavData::unmapAudioBuffer()
+{
+    if (_mappedFile == nullptr) {
+        return;
+    }
+
+    if (_mappedData != nullptr) {
+        // The buffer must not outlive the mapping it refers to
+        _audioBuffer->clear();
+
+        _mappedFile->unmap(_mappedData);
+        _mappedData = nullptr;
+    }
+
+    delete _mappedFile;
+    _mappedFile = nullptr;
+}
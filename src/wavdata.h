@@ -9,6 +9,7 @@ class WavData : public QObject
 
 public:
     explicit WavData(QObject *parent = nullptr);
+    ~WavData();
 
     QAudioFormat *audioFormat() const;
     void setAudioFormat(QAudioFormat *audioFormat);
@@ -16,7 +17,16 @@ public:
     QByteArray *audioBuffer() const;
     void setAudioBuffer(QByteArray *audioData);
 
+    // Makes audioBuffer() a read-only view of size bytes of the file starting at offset
+    // instead of a copy in memory. The file stays mapped until the data is destroyed
+    bool mapAudioBuffer(const QString &filePath, qint64 offset, int size);
+    bool isMapped() const { return _mappedFile != nullptr; }
+
 private:
     QAudioFormat *_audioFormat = nullptr;
     QByteArray *_audioBuffer = nullptr;
+    QFile *_mappedFile = nullptr;
+    uchar *_mappedData = nullptr;
+
+    void unmapAudioBuffer();
 };
@@ -1,43 +1,11 @@
 #include "wavfilereader.h"
 
 #include <qfile.h>
-#include <qendian.h>
+#include <limits>
 #include "wavdata.h"
+#include "wavstreamreader.h"
 #include "filereaderexception.h"
 
-struct ChunkDescriptor
-{
-    char        id[4];
-    quint32     size;
-};
-
-struct RiffHeader
-{
-    ChunkDescriptor descriptor;
-    char            type[4];
-};
-
-struct FmtHeader
-{
-    ChunkDescriptor descriptor;
-    quint16         waveFormat;
-    quint16         numChannels;
-    quint32         sampleRate;
-    quint32         byteRate;
-    quint16         blockAlign;
-    quint16         bitsPerSample;
-};
-
-struct ListHeader
-{
-    ChunkDescriptor descriptor;
-};
-
-struct DataHeader
-{
-    ChunkDescriptor descriptor;
-};
-
 WavFileReader::WavFileReader(const QString &filePath, QObject *parent)
     : QObject(parent)
 {
@@ -52,10 +20,15 @@ WavFileReader::~WavFileReader()
 
 void WavFileReader::readWavData(WavData* rawAudioData, const bool removeWavFileAfterReading) const
 {
+    // Windows does not allow removing a file while it is mapped
+#ifdef Q_OS_WIN
+    const auto mapDataChunk = _readMode == MappedRead && !removeWavFileAfterReading;
+#else
+    const auto mapDataChunk = _readMode == MappedRead;
+#endif
+
     try {
-        openFile();
-        readFile(rawAudioData);
-        closeFile();
+        readFile(rawAudioData, mapDataChunk);
 
         if (removeWavFileAfterReading) {
             removeFile();
@@ -72,145 +45,33 @@ void WavFileReader::readWavData(WavData* rawAudioData, const bool removeWavFileA
     }
 }
 
-void WavFileReader::readFile(WavData *rawAudioData) const
-{
-    const auto audioFormat = rawAudioData->audioFormat();
-    const auto audioBuffer = rawAudioData->audioBuffer();
-
-    auto canRead = true;
-    while (canRead) {
-        char descriptorId[4];
-
-        quint64 pos = _file->pos();
-
-        if (_file->peek(descriptorId, sizeof(descriptorId)) != sizeof(descriptorId)) {
-            throw FileReaderException("Error reading chunk descriptor id of .wav file");
-        }
-
-        if (memcmp(descriptorId, "RIFF", 4) == 0) {
-            readRiffChunk(audioFormat);
-        }
-        else if (memcmp(descriptorId, "RIFX", 4) == 0) {
-            readRiffChunk(audioFormat);
-        }
-        else if (memcmp(descriptorId, "fmt ", 4) == 0) {
-            readFmtChunk(audioFormat);
-        }
-        else if (memcmp(descriptorId, "LIST", 4) == 0) {
-            readListHeader();
-        }
-        else if (memcmp(descriptorId, "data", 4) == 0) {
-            readDataChunk(audioBuffer);
-            canRead = false;
-        }
-    }
-}
-
-void WavFileReader::readRiffChunk(QAudioFormat *audioFormat) const
-{
-    RiffHeader riffHeader{};
-
-    if (_file->read(reinterpret_cast<char *>(&riffHeader), sizeof(RiffHeader)) != sizeof(RiffHeader)) {
-        throw FileReaderException("Error reading RIFF chunk of .wav file");
-    }
-
-    if (memcmp(riffHeader.type, "WAVE", 4) != 0) {
-        throw FileReaderException("'WAVE' file format expected");
-    }
-
-    if (memcmp(&riffHeader.descriptor.id, "RIFF", 4) == 0) {
-        audioFormat->setByteOrder(QAudioFormat::LittleEndian);
-    }
-    else {
-        audioFormat->setByteOrder(QAudioFormat::BigEndian);
-    }
-}
-
-void WavFileReader::readFmtChunk(QAudioFormat *audioFormat) const
+void WavFileReader::readFile(WavData *rawAudioData, const bool mapDataChunk) const
 {
-    FmtHeader fmtHeader{};
+    WavStreamReader streamReader(_file->fileName());
+    streamReader.open();
 
-    if (_file->read(reinterpret_cast<char *>(&fmtHeader), sizeof(FmtHeader)) != sizeof(FmtHeader)) {
-        throw FileReaderException("Error reading fmt chunk of .wav file");
-    }
+    *rawAudioData->audioFormat() = streamReader.audioFormat();
 
-    const auto waveFormat = qFromLittleEndian<quint16>(fmtHeader.waveFormat);
-    if (waveFormat != 1 && waveFormat != 0) {
-        throw FileReaderException("Unexpected audio format of .wav file: ");
+    const auto dataSize = streamReader.dataSize();
+    if (dataSize > std::numeric_limits<int>::max()) {
+        throw FileReaderException(".wav file is too large to be read at once");
     }
 
-    if (qFromLittleEndian<quint32>(fmtHeader.descriptor.size) > sizeof(FmtHeader)) {
-        // Extended data available
-        quint16 extraFormatBytes;
-        if (_file->peek(reinterpret_cast<char*>(&extraFormatBytes), sizeof(quint16)) != sizeof(quint16)) {
-            throw FileReaderException("Error peeking extended data");
-        }
-
-        const qint64 throwAwayBytes = sizeof(quint16) + qFromLittleEndian<quint16>(extraFormatBytes);
-        if (_file->read(throwAwayBytes).size() != throwAwayBytes) {
-            throw FileReaderException("Error reading extended data");
-        }
+    // Samples are read straight from the page cache instead of being copied to the heap first
+    if (mapDataChunk && rawAudioData->mapAudioBuffer(_file->fileName(), streamReader.dataOffset(), static_cast<int>(dataSize))) {
+        return;
     }
 
-    const int bps = qFromLittleEndian<quint16>(fmtHeader.bitsPerSample);
-    audioFormat->setChannelCount(qFromLittleEndian<quint16>(fmtHeader.numChannels));
-    audioFormat->setCodec("audio/pcm");
-    audioFormat->setSampleRate(qFromLittleEndian<quint32>(fmtHeader.sampleRate));
-    audioFormat->setSampleSize(qFromLittleEndian<quint16>(fmtHeader.bitsPerSample));
-    audioFormat->setSampleType(bps == 8 ? QAudioFormat::UnSignedInt : QAudioFormat::SignedInt);
-}
-
-void WavFileReader::readListHeader() const
-{
-    ListHeader listHeader{};
-
-    if (_file->read(reinterpret_cast<char *>(&listHeader), sizeof(ListHeader)) != sizeof(ListHeader)) {
-        throw FileReaderException("Error reading LIST chunk of .wav file");
-    }
-
-    const auto listHeaderSize = qFromLittleEndian<quint32>(listHeader.descriptor.size);
-    const quint64 offset = _file->pos() + listHeaderSize;
-
-    if (!_file->seek(offset)) {
-        throw FileReaderException("Error seeking LIST chunk of .wav file");
-    }
-}
-
-void WavFileReader::readDataChunk(QByteArray *audioBuffer) const
-{
-    DataHeader dataHeader{};
-    if (_file->read(reinterpret_cast<char *>(&dataHeader), sizeof(DataHeader)) != sizeof(DataHeader)) {
-        throw FileReaderException("Error reading DATA chunk of .wav file");
-    }
-
-    audioBuffer->clear();
-    audioBuffer->append(_file->readAll());
+    // The size is known in advance, so the data chunk is read at once into its final buffer
+    // rather than block by block, which would copy every block once more
+    const auto audioBuffer = rawAudioData->audioBuffer();
+    audioBuffer->resize(static_cast<int>(dataSize));
 
-    if (static_cast<uint>(audioBuffer->count()) != qFromLittleEndian(dataHeader.descriptor.size)) {
+    if (streamReader.read(audioBuffer->data(), dataSize) != dataSize) {
         throw FileReaderException("Error reading audio data from .wav file");
     }
 }
 
-void WavFileReader::openFile() const
-{
-    if (_file->isOpen()) {
-        _file->close();
-    }
-
-    if (!_file->exists()) {
-        throw FileReaderException(".wav file not found");
-    }
-
-    if (!_file->open(QIODevice::ReadOnly)) {
-        throw FileReaderException("Error opening the .wav file");
-    }
-}
-
-void WavFileReader::closeFile() const
-{
-    _file->close();
-}
-
 void WavFileReader::removeFile() const
 {
     if (_file->exists())
@@ -9,20 +9,27 @@ class WavFileReader : public QObject
     Q_OBJECT
 
 public:
+    enum ReadMode
+    {
+        // The data chunk is copied into memory
+        BufferedRead,
+        // The data chunk is mapped into memory and read straight from the file
+        MappedRead
+    };
+    Q_ENUM(ReadMode)
+
     explicit WavFileReader(const QString &filePath, QObject *parent = nullptr);
     ~WavFileReader();
 
+    ReadMode readMode() const { return _readMode; }
+    void setReadMode(ReadMode readMode) { _readMode = readMode; }
+
     void readWavData(WavData* rawAudioData, bool removeWavFileAfterReading = false) const;
 
 private:
     QFile *_file = nullptr;
+    ReadMode _readMode = MappedRead;
 
-    void closeFile() const;
-    void openFile() const;
-    void readFile(WavData *rawAudioData) const;
-    void readRiffChunk(QAudioFormat *audioFormat) const;
-    void readFmtChunk(QAudioFormat *audioFormat) const;
-    void readListHeader() const;
-    void readDataChunk(QByteArray *audioBuffer) const;
+    void readFile(WavData *rawAudioData, bool mapDataChunk) const;
     void removeFile() const;
 };
@@ -0,0 +1,285 @@
+#include "wavstreamreader.h"
+
+#include <qendian.h>
+#include "filereaderexception.h"
+
+// Size of a 32-bit chunk whose real size is stored in the ds64 chunk of RF64 and BW64 files
+static const quint32 RF64_SIZE_PLACEHOLDER = 0xFFFFFFFF;
+
+static const quint16 WAVE_FORMAT_PCM = 1;
+static const quint16 WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+struct ChunkDescriptor
+{
+    char        id[4];
+    quint32     size;
+};
+
+struct RiffHeader
+{
+    ChunkDescriptor descriptor;
+    char            type[4];
+};
+
+struct Ds64Chunk
+{
+    quint64     riffSize;
+    quint64     dataSize;
+    quint64     sampleCount;
+};
+
+struct FmtChunk
+{
+    quint16     waveFormat;
+    quint16     numChannels;
+    quint32     sampleRate;
+    quint32     byteRate;
+    quint16     blockAlign;
+    quint16     bitsPerSample;
+};
+
+// Follows the fmt chunk of WAVE_FORMAT_EXTENSIBLE files
+struct FmtExtension
+{
+    quint16     extensionSize;
+    quint16     validBitsPerSample;
+    quint32     channelMask;
+    // The GUID of the actual format, whose first field is the format code
+    quint32     subFormatCode;
+    quint16     subFormatData2;
+    quint16     subFormatData3;
+    quint8      subFormatData4[8];
+};
+
+// The last fields of the GUID shared by all the formats identified by their format codes
+static const quint16 SUB_FORMAT_DATA2 = 0x0000;
+static const quint16 SUB_FORMAT_DATA3 = 0x0010;
+static const quint8 SUB_FORMAT_DATA4[8] = { 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+const int WavStreamReader::DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+WavStreamReader::WavStreamReader(const QString &filePath, const int blockSize, QObject *parent)
+    : QObject(parent),
+      _blockSize(blockSize)
+{
+    _file = new QFile(filePath);
+}
+
+WavStreamReader::~WavStreamReader()
+{
+    _file->close();
+    delete _file;
+}
+
+void WavStreamReader::open()
+{
+    openFile();
+    readRiffChunk();
+
+    auto formatFound = false;
+    auto dataFound = false;
+
+    // The format normally precedes the data, but any order is accepted
+    while (!formatFound || !dataFound) {
+        char id[4];
+        quint32 size;
+
+        if (!readChunkDescriptor(id, &size)) {
+            throw FileReaderException(formatFound ? "data chunk not found in .wav file" : "fmt chunk not found in .wav file");
+        }
+
+        const auto chunkOffset = _file->pos();
+        quint64 chunkSize = size;
+
+        if (memcmp(id, "ds64", 4) == 0) {
+            readDs64Chunk(size);
+        }
+        else if (memcmp(id, "fmt ", 4) == 0) {
+            readFmtChunk(size);
+            formatFound = true;
+        }
+        else if (memcmp(id, "data", 4) == 0) {
+            if (_isRf64 && size == RF64_SIZE_PLACEHOLDER) {
+                // The real size is only known from a ds64 chunk preceding the data
+                if (!_ds64Found) {
+                    throw FileReaderException("ds64 chunk not found in RF64 .wav file");
+                }
+
+                chunkSize = _ds64DataSize;
+            }
+
+            // Files of interrupted recordings may be shorter than their headers claim
+            _dataOffset = chunkOffset;
+            _dataSize = qMin<qint64>(chunkSize, _file->size() - chunkOffset);
+            dataFound = true;
+        }
+
+        // Chunks are skipped as a whole whichever part of them was read, including the pad byte of odd sizes
+        if (!formatFound || !dataFound) {
+            if (!_file->seek(chunkOffset + chunkSize + (chunkSize & 1))) {
+                throw FileReaderException("Error seeking the next chunk of .wav file");
+            }
+        }
+    }
+
+    const auto blockAlign = _audioFormat.bytesPerFrame();
+    if (blockAlign <= 0) {
+        throw FileReaderException("Unexpected block alignment of .wav file");
+    }
+
+    // Blocks never split a frame
+    _blockSize = qMax(blockAlign, _blockSize - _blockSize % blockAlign);
+
+    if (!_file->seek(_dataOffset)) {
+        throw FileReaderException("Error seeking DATA chunk of .wav file");
+    }
+
+    _position = 0;
+}
+
+bool WavStreamReader::readBlock(QByteArray *block)
+{
+    const auto blockSize = static_cast<int>(qMin<qint64>(_blockSize, _dataSize - _position));
+    if (blockSize <= 0) {
+        block->clear();
+        return false;
+    }
+
+    block->resize(blockSize);
+
+    if (read(block->data(), blockSize) != blockSize) {
+        throw FileReaderException("Error reading audio data from .wav file");
+    }
+
+    return true;
+}
+
+qint64 WavStreamReader::read(char *data, const qint64 maxSize)
+{
+    const auto size = qMin(maxSize, _dataSize - _position);
+    if (size <= 0) {
+        return 0;
+    }
+
+    const auto readSize = _file->read(data, size);
+    if (readSize < 0) {
+        throw FileReaderException("Error reading audio data from .wav file");
+    }
+
+    _position += readSize;
+
+    return readSize;
+}
+
+void WavStreamReader::openFile() const
+{
+    if (_file->isOpen()) {
+        _file->close();
+    }
+
+    if (!_file->exists()) {
+        throw FileReaderException(".wav file not found");
+    }
+
+    if (!_file->open(QIODevice::ReadOnly)) {
+        throw FileReaderException("Error opening the .wav file");
+    }
+}
+
+void WavStreamReader::readRiffChunk()
+{
+    RiffHeader riffHeader{};
+
+    if (_file->read(reinterpret_cast<char *>(&riffHeader), sizeof(RiffHeader)) != sizeof(RiffHeader)) {
+        throw FileReaderException("Error reading RIFF chunk of .wav file");
+    }
+
+    if (memcmp(riffHeader.type, "WAVE", 4) != 0) {
+        throw FileReaderException("'WAVE' file format expected");
+    }
+
+    // The samples are consumed as little-endian, so big-endian RIFX files are not read at all
+    if (memcmp(riffHeader.descriptor.id, "RIFX", 4) == 0) {
+        throw FileReaderException("Big-endian RIFX .wav files are not supported");
+    }
+
+    if (memcmp(riffHeader.descriptor.id, "RF64", 4) == 0 || memcmp(riffHeader.descriptor.id, "BW64", 4) == 0) {
+        _isRf64 = true;
+    }
+    else if (memcmp(riffHeader.descriptor.id, "RIFF", 4) != 0) {
+        throw FileReaderException("RIFF chunk of .wav file expected");
+    }
+
+    _audioFormat.setByteOrder(QAudioFormat::LittleEndian);
+}
+
+bool WavStreamReader::readChunkDescriptor(char *id, quint32 *size) const
+{
+    ChunkDescriptor descriptor{};
+
+    if (_file->read(reinterpret_cast<char *>(&descriptor), sizeof(ChunkDescriptor)) != sizeof(ChunkDescriptor)) {
+        return false;
+    }
+
+    memcpy(id, descriptor.id, sizeof(descriptor.id));
+    *size = qFromLittleEndian(descriptor.size);
+
+    return true;
+}
+
+void WavStreamReader::readDs64Chunk(const quint32 chunkSize)
+{
+    Ds64Chunk ds64Chunk{};
+
+    if (chunkSize < sizeof(Ds64Chunk)
+        || _file->read(reinterpret_cast<char *>(&ds64Chunk), sizeof(Ds64Chunk)) != sizeof(Ds64Chunk)) {
+        throw FileReaderException("Error reading ds64 chunk of .wav file");
+    }
+
+    _ds64DataSize = qFromLittleEndian<quint64>(ds64Chunk.dataSize);
+    _ds64Found = true;
+}
+
+void WavStreamReader::readFmtChunk(const quint32 chunkSize)
+{
+    FmtChunk fmtChunk{};
+
+    if (chunkSize < sizeof(FmtChunk)
+        || _file->read(reinterpret_cast<char *>(&fmtChunk), sizeof(FmtChunk)) != sizeof(FmtChunk)) {
+        throw FileReaderException("Error reading fmt chunk of .wav file");
+    }
+
+    // Only integer PCM is read. The extensible format keeps the actual format in its extension,
+    // which may as well be IEEE float or a compressed one
+    const auto waveFormat = qFromLittleEndian(fmtChunk.waveFormat);
+    if (waveFormat == WAVE_FORMAT_EXTENSIBLE) {
+        readFmtExtension(chunkSize);
+    }
+    else if (waveFormat != WAVE_FORMAT_PCM) {
+        throw FileReaderException("Unexpected audio format of .wav file");
+    }
+
+    const int bitsPerSample = qFromLittleEndian(fmtChunk.bitsPerSample);
+    _audioFormat.setChannelCount(qFromLittleEndian(fmtChunk.numChannels));
+    _audioFormat.setCodec("audio/pcm");
+    _audioFormat.setSampleRate(qFromLittleEndian(fmtChunk.sampleRate));
+    _audioFormat.setSampleSize(bitsPerSample);
+    _audioFormat.setSampleType(bitsPerSample == 8 ? QAudioFormat::UnSignedInt : QAudioFormat::SignedInt);
+}
+
+void WavStreamReader::readFmtExtension(const quint32 chunkSize)
+{
+    FmtExtension fmtExtension{};
+
+    if (chunkSize < sizeof(FmtChunk) + sizeof(FmtExtension)
+        || _file->read(reinterpret_cast<char *>(&fmtExtension), sizeof(FmtExtension)) != sizeof(FmtExtension)) {
+        throw FileReaderException("Error reading fmt chunk of .wav file");
+    }
+
+    if (qFromLittleEndian(fmtExtension.subFormatCode) != WAVE_FORMAT_PCM
+        || qFromLittleEndian(fmtExtension.subFormatData2) != SUB_FORMAT_DATA2
+        || qFromLittleEndian(fmtExtension.subFormatData3) != SUB_FORMAT_DATA3
+        || memcmp(fmtExtension.subFormatData4, SUB_FORMAT_DATA4, sizeof(SUB_FORMAT_DATA4)) != 0) {
+        throw FileReaderException("Unexpected audio format of .wav file");
+    }
+}
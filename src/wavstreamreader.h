@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+#include <QFile>
+#include <QAudioFormat>
+
+// Reads the audio data of a .wav file block by block, so memory use does not depend on the file size.
+// All chunks of the file are walked in any order and the unknown ones are skipped.
+// RF64 and BW64 files, whose sizes do not fit into 32 bits, are supported through their ds64 chunk.
+// Big-endian RIFX files are rejected.
+class WavStreamReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_BLOCK_SIZE;
+
+    explicit WavStreamReader(const QString &filePath, int blockSize = DEFAULT_BLOCK_SIZE, QObject *parent = nullptr);
+    ~WavStreamReader();
+
+    // Reads the chunks describing the audio data and positions the reader at its beginning
+    void open();
+
+    const QAudioFormat &audioFormat() const { return _audioFormat; }
+
+    qint64 dataOffset() const { return _dataOffset; }
+    qint64 dataSize() const { return _dataSize; }
+    qint64 position() const { return _position; }
+    bool atEnd() const { return _position >= _dataSize; }
+
+    // Reads the next block of whole frames, at most the block size long, for consumers processing
+    // the audio data while it is read. Returns false after the last block
+    bool readBlock(QByteArray *block);
+
+    // Reads up to maxSize bytes of the audio data and returns the number of bytes read
+    qint64 read(char *data, qint64 maxSize);
+
+private:
+    QFile *_file = nullptr;
+    int _blockSize;
+
+    QAudioFormat _audioFormat;
+    bool _isRf64 = false;
+    bool _ds64Found = false;
+    quint64 _ds64DataSize = 0;
+
+    qint64 _dataOffset = 0;
+    qint64 _dataSize = 0;
+    qint64 _position = 0;
+
+    void openFile() const;
+    void readRiffChunk();
+    bool readChunkDescriptor(char *id, quint32 *size) const;
+    void readDs64Chunk(quint32 chunkSize);
+    void readFmtChunk(quint32 chunkSize);
+    void readFmtExtension(quint32 chunkSize);
+};
@@ -0,0 +1,495 @@
+#include <QtTest>
+#include <random>
+#include "realfftengine.h"
+#include "simdkernels.h"
+#include "spectrumanalyzer.h"
+
+// Every vectorized kernel is checked against the scalar reference one. Counts cover empty inputs,
+// inputs shorter than a register and inputs leaving a tail after the last full register
+static const int COUNTS[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 64, 101, 1023 };
+static const quint32 RANDOM_SEED = 20190325;
+static const quint32 SAMPLE_RATE_HZ = 25600;
+static const int MAX_FFT_SIZE = 1024;
+
+class AnalysisTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void butterfly_data() { addInstructionSets(); }
+    void butterfly();
+    void magnitude_data() { addInstructionSets(); }
+    void magnitude();
+    void int16ToReal_data() { addInstructionSets(); }
+    void int16ToReal();
+    void int16ToComplex_data() { addInstructionSets(); }
+    void int16ToComplex();
+    void deinterleaveStereo_data() { addInstructionSets(); }
+    void deinterleaveStereo();
+    void downmixStereo_data() { addInstructionSets(); }
+    void downmixStereo();
+    void fftEngine_data() { addFftSizes(1); }
+    void fftEngine();
+    void realFftEngine_data() { addFftSizes(2); }
+    void realFftEngine();
+    void singlePrecisionSpectrogram_data();
+    void singlePrecisionSpectrogram();
+
+private:
+    static void addInstructionSets();
+    static const SimdKernels *vectorKernels();
+    static void addFftSizes(int minSize);
+};
+
+// Relative tolerance of a vectorized kernel, which may round differently than the scalar one
+template<typename T>
+static T tolerance();
+
+template<>
+double tolerance<double>()
+{
+    return 1e-12;
+}
+
+template<>
+float tolerance<float>()
+{
+    return 1e-5f;
+}
+
+template<typename T>
+static bool fuzzyEqual(const std::complex<T> &actual, const std::complex<T> &expected)
+{
+    return std::abs(actual - expected) <= tolerance<T>() * qMax(T(1), std::abs(expected));
+}
+
+static bool fuzzyEqual(const float actual, const float expected)
+{
+    return qAbs(actual - expected) <= tolerance<float>() * qMax(1.0f, qAbs(expected));
+}
+
+// Samples of the whole 16-bit range, starting with both extremes
+static QVector<qint16> randomSamples(const int count)
+{
+    std::mt19937 random(RANDOM_SEED);
+    std::uniform_int_distribution<int> values(-32768, 32767);
+
+    QVector<qint16> samples(count);
+    for (auto i = 0; i < count; i++)
+    {
+        samples[i] = static_cast<qint16>(i == 0 ? -32768 : i == 1 ? 32767 : values(random));
+    }
+
+    return samples;
+}
+
+// Quiet tones over noise, which keeps most FFT magnitudes in the analyzed amplitude range
+static QVector<qint16> syntheticSignal(const int count)
+{
+    static const double FREQUENCIES_HZ[] = { 440.0, 1250.0, 3170.0 };
+
+    std::mt19937 random(RANDOM_SEED);
+    std::uniform_int_distribution<int> noise(-300, 300);
+
+    QVector<qint16> samples(count);
+    for (auto i = 0; i < count; i++)
+    {
+        auto value = 0.0;
+        for (const auto frequencyHz : FREQUENCIES_HZ)
+        {
+            value += 20.0 * qSin(2.0 * M_PI * frequencyHz * i / SAMPLE_RATE_HZ);
+        }
+
+        samples[i] = static_cast<qint16>(value + noise(random));
+    }
+
+    return samples;
+}
+
+// Values of the order of FFT results of 16-bit fragments
+template<typename T>
+static QVector<std::complex<T>> randomComplexValues(const int count, const quint32 seed = RANDOM_SEED)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<T> values(-1e6, 1e6);
+
+    QVector<std::complex<T>> complexValues(count);
+    for (auto &complexValue : complexValues)
+    {
+        complexValue = std::complex<T>(values(random), values(random));
+    }
+
+    return complexValues;
+}
+
+// The DFT by its definition, computed in extended precision with exactly reduced angles
+template<typename T>
+static QVector<std::complex<long double>> naiveDft(const QVector<std::complex<T>> &input)
+{
+    const auto size = input.size();
+
+    QVector<std::complex<long double>> spectrum(size);
+    for (auto k = 0; k < size; k++)
+    {
+        std::complex<long double> sum = 0;
+        for (auto n = 0; n < size; n++)
+        {
+            const auto angle = -2.0L * M_PI * ((static_cast<qint64>(k) * n) % size) / size;
+            sum += std::complex<long double>(input[n].real(), input[n].imag()) * std::polar(1.0L, angle);
+        }
+
+        spectrum[k] = sum;
+    }
+
+    return spectrum;
+}
+
+// FFT errors grow with the whole spectrum rather than with a single bin, so every bin is compared
+// relative to the largest magnitude, and with a margin of the log2(size) passes for the rounding
+template<typename T>
+static void compareWithDft(const std::complex<T> *actual, const QVector<std::complex<long double>> &expected, const int count)
+{
+    auto maxMagnitude = 1.0L;
+    for (auto k = 0; k < count; k++)
+    {
+        maxMagnitude = qMax(maxMagnitude, std::abs(expected[k]));
+    }
+
+    const auto maxError = tolerance<T>() * maxMagnitude * qMax(1, qCeil(log2(expected.size())));
+    for (auto k = 0; k < count; k++)
+    {
+        const auto error = std::abs(std::complex<long double>(actual[k].real(), actual[k].imag()) - expected[k]);
+        QVERIFY2(error <= maxError, qPrintable(QString("Bin %1 of %2").arg(k).arg(expected.size())));
+    }
+}
+
+template<typename T>
+static void compareFftEngine(const int size)
+{
+    const auto input = randomComplexValues<T>(size);
+    const auto expected = naiveDft(input);
+
+    auto actual = input;
+    FftEngine<T>(size).transform(actual.data());
+
+    compareWithDft(actual.constData(), expected, size);
+}
+
+template<typename T>
+static void compareRealFftEngine(const int size)
+{
+    typedef std::complex<T> Complex;
+
+    // Real samples are packed in pairs, even ones as real parts and odd ones as imaginary parts
+    const auto packed = randomComplexValues<T>(size / 2);
+
+    QVector<Complex> input(size);
+    for (auto n = 0; n < size; n++)
+    {
+        input[n] = Complex(n % 2 == 0 ? packed[n / 2].real() : packed[n / 2].imag(), 0);
+    }
+
+    const auto expected = naiveDft(input);
+
+    const RealFftEngine<T> engine(size);
+
+    auto actual = packed;
+    actual.resize(engine.spectrumSize());
+    engine.transform(actual.data());
+
+    compareWithDft(actual.constData(), expected, engine.spectrumSize());
+}
+
+template<typename T>
+static void compareButterfly(const SimdKernelTable<T> &kernels, const SimdKernelTable<T> &reference)
+{
+    typedef std::complex<T> Complex;
+
+    for (const auto count : COUNTS)
+    {
+        const auto even = randomComplexValues<T>(count);
+        const auto odd = randomComplexValues<T>(count, RANDOM_SEED + 1);
+
+        QVector<Complex> twiddles(count);
+        for (auto k = 0; k < count; k++)
+        {
+            twiddles[k] = std::polar(T(1), static_cast<T>(-M_PI * k / qMax(1, count)));
+        }
+
+        auto expectedEven = even;
+        auto expectedOdd = odd;
+        reference.butterfly(expectedEven.data(), expectedOdd.data(), twiddles.constData(), count);
+
+        auto actualEven = even;
+        auto actualOdd = odd;
+        kernels.butterfly(actualEven.data(), actualOdd.data(), twiddles.constData(), count);
+
+        for (auto k = 0; k < count; k++)
+        {
+            QVERIFY2(fuzzyEqual(actualEven[k], expectedEven[k]) && fuzzyEqual(actualOdd[k], expectedOdd[k]),
+                     qPrintable(QString("Value %1 of %2").arg(k).arg(count)));
+        }
+    }
+}
+
+template<typename T>
+static void compareMagnitude(const SimdKernelTable<T> &kernels, const SimdKernelTable<T> &reference)
+{
+    for (const auto count : COUNTS)
+    {
+        const auto spectra = randomComplexValues<T>(count);
+
+        QVector<float> expected(count);
+        reference.magnitude(spectra.constData(), expected.data(), count);
+
+        QVector<float> actual(count);
+        kernels.magnitude(spectra.constData(), actual.data(), count);
+
+        for (auto k = 0; k < count; k++)
+        {
+            QVERIFY2(fuzzyEqual(actual[k], expected[k]), qPrintable(QString("Value %1 of %2").arg(k).arg(count)));
+        }
+    }
+}
+
+// Conversions of integers are exact, so the results have to be identical
+template<typename T>
+static void compareInt16ToReal(const SimdKernelTable<T> &kernels, const SimdKernelTable<T> &reference)
+{
+    for (const auto count : COUNTS)
+    {
+        const auto samples = randomSamples(count);
+
+        QVector<T> expected(count);
+        reference.int16ToReal(samples.constData(), expected.data(), count);
+
+        QVector<T> actual(count);
+        kernels.int16ToReal(samples.constData(), actual.data(), count);
+
+        QCOMPARE(actual, expected);
+    }
+}
+
+template<typename T>
+static void compareInt16ToComplex(const SimdKernelTable<T> &kernels, const SimdKernelTable<T> &reference)
+{
+    for (const auto count : COUNTS)
+    {
+        const auto samples = randomSamples(count);
+
+        QVector<std::complex<T>> expected(count);
+        reference.int16ToComplex(samples.constData(), expected.data(), count);
+
+        QVector<std::complex<T>> actual(count);
+        kernels.int16ToComplex(samples.constData(), actual.data(), count);
+
+        QVERIFY(actual == expected);
+    }
+}
+
+void AnalysisTests::addInstructionSets()
+{
+    QTest::addColumn<int>("instructionSet");
+
+    QTest::newRow("SSE2") << static_cast<int>(SimdKernels::Sse2);
+    QTest::newRow("AVX2") << static_cast<int>(SimdKernels::Avx2);
+}
+
+const SimdKernels *AnalysisTests::vectorKernels()
+{
+    QFETCH(int, instructionSet);
+
+    return SimdKernels::forInstructionSet(static_cast<SimdKernels::InstructionSet>(instructionSet));
+}
+
+void AnalysisTests::addFftSizes(const int minSize)
+{
+    QTest::addColumn<int>("size");
+
+    for (auto size = minSize; size <= MAX_FFT_SIZE; size <<= 1)
+    {
+        QTest::newRow(qPrintable(QString::number(size))) << size;
+    }
+}
+
+void AnalysisTests::butterfly()
+{
+    const auto kernels = vectorKernels();
+    if (kernels == nullptr)
+    {
+        QSKIP("The instruction set is not supported by the build or the CPU");
+    }
+
+    const auto &reference = *SimdKernels::forInstructionSet(SimdKernels::Scalar);
+
+    compareButterfly(kernels->doublePrecision, reference.doublePrecision);
+    compareButterfly(kernels->singlePrecision, reference.singlePrecision);
+}
+
+void AnalysisTests::magnitude()
+{
+    const auto kernels = vectorKernels();
+    if (kernels == nullptr)
+    {
+        QSKIP("The instruction set is not supported by the build or the CPU");
+    }
+
+    const auto &reference = *SimdKernels::forInstructionSet(SimdKernels::Scalar);
+
+    compareMagnitude(kernels->doublePrecision, reference.doublePrecision);
+    compareMagnitude(kernels->singlePrecision, reference.singlePrecision);
+}
+
+void AnalysisTests::int16ToReal()
+{
+    const auto kernels = vectorKernels();
+    if (kernels == nullptr)
+    {
+        QSKIP("The instruction set is not supported by the build or the CPU");
+    }
+
+    const auto &reference = *SimdKernels::forInstructionSet(SimdKernels::Scalar);
+
+    compareInt16ToReal(kernels->doublePrecision, reference.doublePrecision);
+    compareInt16ToReal(kernels->singlePrecision, reference.singlePrecision);
+}
+
+void AnalysisTests::int16ToComplex()
+{
+    const auto kernels = vectorKernels();
+    if (kernels == nullptr)
+    {
+        QSKIP("The instruction set is not supported by the build or the CPU");
+    }
+
+    const auto &reference = *SimdKernels::forInstructionSet(SimdKernels::Scalar);
+
+    compareInt16ToComplex(kernels->doublePrecision, reference.doublePrecision);
+    compareInt16ToComplex(kernels->singlePrecision, reference.singlePrecision);
+}
+
+void AnalysisTests::deinterleaveStereo()
+{
+    const auto kernels = vectorKernels();
+    if (kernels == nullptr)
+    {
+        QSKIP("The instruction set is not supported by the build or the CPU");
+    }
+
+    const auto &reference = *SimdKernels::forInstructionSet(SimdKernels::Scalar);
+
+    for (const auto framesCount : COUNTS)
+    {
+        const auto frames = randomSamples(framesCount * 2);
+
+        QVector<qint16> expectedLeft(framesCount);
+        QVector<qint16> expectedRight(framesCount);
+        reference.deinterleaveStereo(frames.constData(), expectedLeft.data(), expectedRight.data(), framesCount);
+
+        QVector<qint16> actualLeft(framesCount);
+        QVector<qint16> actualRight(framesCount);
+        kernels->deinterleaveStereo(frames.constData(), actualLeft.data(), actualRight.data(), framesCount);
+
+        QCOMPARE(actualLeft, expectedLeft);
+        QCOMPARE(actualRight, expectedRight);
+    }
+}
+
+void AnalysisTests::downmixStereo()
+{
+    const auto kernels = vectorKernels();
+    if (kernels == nullptr)
+    {
+        QSKIP("The instruction set is not supported by the build or the CPU");
+    }
+
+    const auto &reference = *SimdKernels::forInstructionSet(SimdKernels::Scalar);
+
+    for (const auto framesCount : COUNTS)
+    {
+        const auto frames = randomSamples(framesCount * 2);
+
+        QVector<qint16> expected(framesCount);
+        reference.downmixStereo(frames.constData(), expected.data(), framesCount);
+
+        QVector<qint16> actual(framesCount);
+        kernels->downmixStereo(frames.constData(), actual.data(), framesCount);
+
+        QCOMPARE(actual, expected);
+    }
+}
+
+void AnalysisTests::fftEngine()
+{
+    QFETCH(int, size);
+
+    compareFftEngine<double>(size);
+    compareFftEngine<float>(size);
+}
+
+void AnalysisTests::realFftEngine()
+{
+    QFETCH(int, size);
+
+    compareRealFftEngine<double>(size);
+    compareRealFftEngine<float>(size);
+}
+
+void AnalysisTests::singlePrecisionSpectrogram_data()
+{
+    QTest::addColumn<int>("fftMode");
+    QTest::addColumn<int>("samplesPerFragment");
+    QTest::addColumn<int>("hopSize");
+
+    QTest::newRow("complex FFT") << static_cast<int>(SpectrumAnalyzer::ComplexFft) << 512 << 512;
+    QTest::newRow("real FFT") << static_cast<int>(SpectrumAnalyzer::RealFft) << 512 << 512;
+    QTest::newRow("real FFT, Hann window") << static_cast<int>(SpectrumAnalyzer::RealFft) << 2048 << 512;
+}
+
+void AnalysisTests::singlePrecisionSpectrogram()
+{
+    // Rounding moves an amplitude lying close to a step of the histogram into the neighbouring band,
+    // so a few energies differ by a unit. Anything more is an error of the float pipeline
+    static const double MAX_RELATIVE_ERROR = 1e-4;
+    static const int MAX_ENERGY_DIFFERENCE = 1;
+
+    QFETCH(int, fftMode);
+    QFETCH(int, samplesPerFragment);
+    QFETCH(int, hopSize);
+
+    const auto samples = syntheticSignal(SAMPLE_RATE_HZ * 10);
+    const auto window = samplesPerFragment == hopSize ? StftFramer::RectangularWindow : StftFramer::HannWindow;
+
+    SpectrumAnalyzer spectrumAnalyzer(nullptr);
+    spectrumAnalyzer.setFftMode(static_cast<SpectrumAnalyzer::FftMode>(fftMode));
+
+    spectrumAnalyzer.setPrecision(SpectrumAnalyzer::DoublePrecision);
+    const auto expected = spectrumAnalyzer.getFrequencySpectrogram(&samples, SAMPLE_RATE_HZ, samplesPerFragment, hopSize, window);
+
+    spectrumAnalyzer.setPrecision(SpectrumAnalyzer::SinglePrecision);
+    const auto actual = spectrumAnalyzer.getFrequencySpectrogram(&samples, SAMPLE_RATE_HZ, samplesPerFragment, hopSize, window);
+
+    QCOMPARE(actual.framesCount(), expected.framesCount());
+    QCOMPARE(actual.bandsCount(), expected.bandsCount());
+
+    qint64 energiesSum = 0;
+    qint64 differencesSum = 0;
+    for (auto frame = 0; frame < expected.framesCount(); frame++)
+    {
+        for (auto band = 0; band < expected.bandsCount(); band++)
+        {
+            const auto difference = qAbs(actual.row(frame)[band] - expected.row(frame)[band]);
+            QVERIFY2(difference <= MAX_ENERGY_DIFFERENCE, qPrintable(QString("Band %1 of fragment %2").arg(band).arg(frame)));
+
+            energiesSum += expected.row(frame)[band];
+            differencesSum += difference;
+        }
+    }
+
+    QVERIFY(energiesSum > 0);
+    QVERIFY(static_cast<double>(differencesSum) / energiesSum <= MAX_RELATIVE_ERROR);
+}
+
+QTEST_APPLESS_MAIN(AnalysisTests)
+
+#include "analysistests.moc"
@@ -0,0 +1,38 @@
+#-------------------------------------------------
+#
+# Unit tests of the analysis pipeline, built on Qt Test.
+# Run with "make check" or by starting the executable
+#
+#-------------------------------------------------
+
+QT       += core \
+            concurrent \
+            testlib
+
+QT       -= gui
+
+TARGET = VSPlayerTests
+TEMPLATE = app
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+INCLUDEPATH += ../src
+
+SOURCES += \
+    analysistests.cpp \
+    ../src/baseexception.cpp \
+    ../src/pipelinestats.cpp \
+    ../src/fftengine.cpp \
+    ../src/realfftengine.cpp \
+    ../src/fftplan.cpp \
+    ../src/simdkernels.cpp \
+    ../src/stftframer.cpp \
+    ../src/spectrogram.cpp \
+    ../src/spectrumanalyzer.cpp
+
+HEADERS += \
+    ../src/simdkernels.h \
+    ../src/spectrumanalyzer.h